@@ -14,8 +14,11 @@ Rectangle {
     color: "black"
     height: 1
 
-    x: x1
-    y: y1 - height / 2
+    // shifts the line sideways, lets two one-way paths between the same towns be told apart
+    property real offset: 0
+
+    x: x1 - offset * (y2 - y1) / Math.max(width, 1)
+    y: y1 - height / 2 + offset * (x2 - x1) / Math.max(width, 1)
     property real x1
     property real y1
     property real x2
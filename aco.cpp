@@ -23,7 +23,11 @@
  */
 
 #include "aco.h"
+#include "tsplib.h"
 #include <QFile>
+#include <QJsonDocument>
+
+#include <algorithm>
 
 ////////////////
 //                  TOWN
@@ -107,6 +111,14 @@ Town *Path::townB() {
     return m_b;
 }
 
+Town *Path::otherTown(Town *t) {
+    return t == m_a ? m_b : m_a;
+}
+
+bool Path::explicitDistance() {
+    return m_distance >= 0.0;
+}
+
 qreal Path::distance() {
     if (m_distance < 0.0)
         return sqrt(pow(m_a->x() - m_b->x(), 2) + pow(m_a->y() - m_b->y(), 2)) / 64.0;
@@ -142,7 +154,10 @@ Ant::Ant(Algorithm *parent, Town *town)
     connect(town, &Town::xChanged, this, &Ant::xChanged);
     connect(town, &Town::yChanged, this, &Ant::yChanged);
     connect(this, &Ant::townChanged, this, &Ant::tripChanged);
-    m_taboo.append(town);
+    connect(aco(), &Canvas::pathsChanged, this, &Ant::invalidateTrip);
+    connect(aco(), &Canvas::distancesChanged, this, &Ant::invalidateTripLength);
+    m_visited.fill(false, aco()->towns().size());
+    visit(town);
 }
 
 Aco *Ant::aco() {
@@ -158,12 +173,18 @@ void Ant::step() {
     QMap<Town*, qreal> weights;
     qreal target = aco()->getRand();
     qreal current = 0.0;
-    for (int i = 0; i < aco()->towns().size(); i++) {
-        Town *t = aco()->towns()[i];
-        if (!m_taboo.contains(t)) {
-            qreal currentWeight = 0.0;
-            Path *p = aco()->pathBetween(t, m_taboo.last());
-            currentWeight = pow(p->trail(), algorithm()->alpha()) * pow(1.0 / p->distance(), algorithm()->beta());
+    // only the paths leaving the current town matter, on a sparse map the
+    // ant may end up with none and its trip won't be complete
+    Town *last = m_taboo.last();
+    const qreal alpha = algorithm()->alpha();
+    const qreal beta = algorithm()->beta();
+    WeightFunction weight = weightFunction(alpha, beta);
+    for (Path *p : aco()->pathsOf(last)) {
+        if (aco()->directed() && p->townA() != last)
+            continue;
+        Town *t = p->otherTown(last);
+        if (!m_visited.value(aco()->indexOf(t), true)) {
+            qreal currentWeight = weight(p->trail(), p->distance(), alpha, beta);
             totalWeight += currentWeight;
             weights[t] = currentWeight;
         }
@@ -180,15 +201,28 @@ void Ant::step() {
 
 void Ant::reset(Town *t) {
     m_taboo.clear();
+    m_tripTowns.clear();
+    m_visited.fill(false);
+    invalidateTrip();
     setTown(t);
 }
 
 qreal Ant::tripLength() {
-    qreal ret = 0.0;
-    for (int i = 0; i < m_taboo.size() - 1; i++) {
-        ret += aco()->pathBetween(m_taboo[i], m_taboo[i + 1])->distance();
+    if (m_tripLength >= 0.0)
+        return m_tripLength;
+    const QList<Path*> &paths = trip();
+    m_tripLength = 0.0;
+    if (paths.size() < m_taboo.size() - 1)
+        m_tripLength = HUGE_VAL;
+    else {
+        for (Path *p : paths)
+            m_tripLength += p->distance();
     }
-    return ret;
+    return m_tripLength;
+}
+
+bool Ant::complete() {
+    return m_taboo.size() == aco()->towns().size() + 1 && tripLength() < HUGE_VAL;
 }
 
 Town *Ant::town() {
@@ -211,16 +245,30 @@ QQmlListProperty<Town> Ant::tabooListProperty() {
     return QQmlListProperty<Town>(this, m_taboo);
 }
 
-QList<Path *> Ant::trip() {
-    QList<Path*> paths;
-    for (int i = 0; i < m_taboo.size() - 1; i++)
-        paths.append(aco()->pathBetween(m_taboo[i], m_taboo[i+1]));
-    return paths;
+QList<Town *> Ant::taboo() {
+    return m_taboo;
+}
+
+const QList<Path *> &Ant::trip() {
+    if (!m_tripValid) {
+        m_trip.clear();
+        for (int i = 0; i < m_taboo.size() - 1; i++) {
+            Path *p = aco()->pathBetween(m_taboo[i], m_taboo[i + 1]);
+            if (p)
+                m_trip.append(p);
+        }
+        m_tripValid = true;
+    }
+    return m_trip;
+}
+
+const QVector<int> &Ant::tripTowns() {
+    return m_tripTowns;
 }
 
 QQmlListProperty<Path> Ant::tripListProperty() {
-    QList<Path*> tmp = trip();
-    return QQmlListProperty<Path>(this, tmp);
+    trip();
+    return QQmlListProperty<Path>(this, m_trip);
 }
 
 void Ant::setTown(Town *town) {
@@ -228,7 +276,7 @@ void Ant::setTown(Town *town) {
         disconnect(m_town, &Town::xChanged, this, &Ant::xChanged);
         disconnect(m_town, &Town::yChanged, this, &Ant::yChanged);
         m_town = town;
-        m_taboo.append(town);
+        visit(town);
         connect(town, &Town::xChanged, this, &Ant::xChanged);
         connect(town, &Town::yChanged, this, &Ant::yChanged);
         emit townChanged();
@@ -238,6 +286,31 @@ void Ant::setTown(Town *town) {
     }
 }
 
+void Ant::invalidateTrip() {
+    m_tripValid = false;
+    m_tripLength = -1.0;
+}
+
+void Ant::invalidateTripLength() {
+    m_tripLength = -1.0;
+}
+
+void Ant::visit(Town *town) {
+    int index = aco()->indexOf(town);
+    m_taboo.append(town);
+    m_tripTowns.append(index);
+    if (index >= 0 && index < m_visited.size())
+        m_visited[index] = true;
+    // only the path to the new town is missing, the cached ones stay valid
+    if (m_tripValid && m_taboo.size() > 1) {
+        if (Path *p = aco()->pathBetween(m_taboo[m_taboo.size() - 2], town))
+            m_trip.append(p);
+        else
+            m_tripValid = false;
+    }
+    m_tripLength = -1.0;
+}
+
 
 ////////////////
 //                  ALGORITHM
@@ -302,19 +375,72 @@ qreal Algorithm::e() {
     return m_e;
 }
 
+qreal Algorithm::restartBranching() {
+    return m_restartBranching;
+}
+
+int Algorithm::restartIdle() {
+    return m_restartIdle;
+}
+
+qreal Algorithm::branching() {
+    return m_convergence.branching;
+}
+
+qreal Algorithm::entropy() {
+    return m_convergence.entropy;
+}
+
+int Algorithm::idleCycles() {
+    return m_convergence.idleCycles;
+}
+
+int Algorithm::restarts() {
+    return m_convergence.restarts;
+}
+
 QQmlListProperty<Path> Algorithm::shortestTripProperty() {
     return QQmlListProperty<Path>(this, m_shortestTrip);
 }
 
+void Algorithm::offerTrip(const QVector<int> &trip, qreal length) {
+    if (length < m_shortestTripLength)
+        setShortestTrip(trip, length);
+}
+
+void Algorithm::setShortestTrip(const QVector<int> &trip, qreal length) {
+    // the trip may pass through some towns more than once on a sparse map
+    if (trip.size() < aco()->towns().size())
+        return;
+    QList<Path*> paths;
+    for (int town : trip) {
+        if (town < 0 || town >= aco()->towns().size())
+            return;
+    }
+    for (int i = 0; i < trip.size(); i++) {
+        Path *p = aco()->pathBetween(aco()->towns()[trip[i]], aco()->towns()[trip[(i + 1) % trip.size()]]);
+        if (!p)
+            return;
+        paths.append(p);
+    }
+    m_shortestTrip = paths;
+    m_shortestTripLength = length;
+    emit shortestTripChanged();
+}
+
+void Algorithm::clearShortestTrip() {
+    m_shortestTrip.clear();
+    m_shortestTripLength = HUGE_VAL;
+    emit shortestTripChanged();
+}
+
 void Algorithm::reset() {
     while (!m_ants.isEmpty()) {
         m_ants.first()->deleteLater();
         m_ants.removeFirst();
     }
     emit antsChanged();
-    m_shortestTrip.clear();
-    m_shortestTripLength = HUGE_VAL;
-    emit shortestTripChanged();
+    clearShortestTrip();
     m_t = 0;
     m_s = 0;
     m_c = 0;
@@ -326,6 +452,10 @@ void Algorithm::reset() {
     for (Path *p : aco()->paths()) {
         p->setTrail(aco()->initialTau());
     }
+    m_lastImprovement = 0;
+    m_lastRestart = 0;
+    m_convergence = Convergence();
+    emit convergenceChanged();
 }
 
 void Algorithm::roundInit() {
@@ -361,7 +491,10 @@ void Algorithm::step() {
         int shortestPos = -1;
         for (int i = 0; i < m_ants.size(); i++) {
             m_ants[i]->setTown(m_ants[i]->firstTown());
-            QList<Path*> trip = m_ants[i]->trip();
+            // ants that got stuck on a sparse map don't leave any trail
+            if (!m_ants[i]->complete())
+                continue;
+            const QList<Path*> &trip = m_ants[i]->trip();
             qreal tripLength = m_ants[i]->tripLength();
             if (tripLength < shortest) {
                 shortest = tripLength;
@@ -383,11 +516,17 @@ void Algorithm::step() {
                 }
             }
         }
-        if (shortest < m_shortestTripLength && m_ants[shortestPos]->trip().size() == aco()->towns().size()) {
+        if (shortestPos >= 0 && shortest < m_shortestTripLength) {
             m_shortestTrip = m_ants[shortestPos]->trip();
             m_shortestTripLength = shortest;
+            m_lastImprovement = m_c;
             emit shortestTripChanged();
         }
+        measureConvergence();
+        bool branched = m_restartBranching > 0.0 && m_convergence.settled && m_convergence.branching < m_restartBranching;
+        bool idle = m_restartIdle > 0 && m_c - qMax(m_lastImprovement, m_lastRestart) >= m_restartIdle;
+        if (branched || idle)
+            restartTrails();
         roundInit();
     }
 }
@@ -446,6 +585,83 @@ void Algorithm::setE(qreal e) {
     }
 }
 
+void Algorithm::setRestartBranching(qreal branching) {
+    if (m_restartBranching != branching) {
+        m_restartBranching = branching;
+        emit restartBranchingChanged();
+    }
+}
+
+void Algorithm::setRestartIdle(int cycles) {
+    if (m_restartIdle != cycles) {
+        m_restartIdle = cycles;
+        emit restartIdleChanged();
+    }
+}
+
+void Algorithm::restartTrails() {
+    for (Path *p : aco()->paths())
+        p->setTrail(aco()->initialTau());
+    // only the shortest trip so far keeps a trail, as in the colonies
+    for (Path *p : m_shortestTrip) {
+        qreal amount = q();
+        if (aco()->chosenAlgo() == Aco::AntCycle || aco()->chosenAlgo() == Aco::ElitistStrategy)
+            amount /= m_shortestTripLength;
+        else if (aco()->chosenAlgo() == Aco::AntQuantity)
+            amount /= p->distance();
+        p->setTrail(p->trail() + e() * amount);
+    }
+    m_lastRestart = m_c;
+    Convergence convergence;
+    convergence.restarts = m_convergence.restarts + 1;
+    m_convergence = convergence;
+    emit convergenceChanged();
+}
+
+void Algorithm::measureConvergence() {
+    QList<Town*> &towns = aco()->towns();
+    if (towns.isEmpty())
+        return;
+
+    int branches = 0;
+    for (Town *t : towns) {
+        QList<Path*> paths;
+        for (Path *p : aco()->pathsOf(t)) {
+            if (!aco()->directed() || p->townA() == t)
+                paths.append(p);
+        }
+        qreal min = HUGE_VAL;
+        qreal max = 0.0;
+        for (Path *p : paths) {
+            min = qMin(min, p->trail());
+            max = qMax(max, p->trail());
+        }
+        for (Path *p : paths) {
+            if (p->trail() >= min + Convergence::lambda * (max - min))
+                branches++;
+        }
+    }
+    // both paths of a town on the trip are strong when they go both ways
+    m_convergence.branching = qreal(branches) / ((aco()->directed() ? 1 : 2) * towns.size());
+
+    // the town each ant went to from every town
+    QVector<QVector<int>> successors(towns.size());
+    for (Ant *a : m_ants) {
+        if (!a->complete())
+            continue;
+        const QVector<int> &trip = a->tripTowns();
+        for (int i = 0; i < trip.size() - 1; i++)
+            successors[trip[i]].append(trip[i + 1]);
+    }
+    qreal entropy = 0.0;
+    for (QVector<int> &next : successors)
+        entropy += Convergence::entropyOf(next.data(), next.size());
+    m_convergence.entropy = entropy / towns.size();
+    m_convergence.idleCycles = m_c - m_lastImprovement;
+    m_convergence.settled = m_c - m_lastRestart >= Convergence::settleCycles;
+    emit convergenceChanged();
+}
+
 void Algorithm::slotDistancesChanged() {
     if (m_shortestTrip.count() == 0)
         m_shortestTripLength = HUGE_VAL;
@@ -469,26 +685,34 @@ Canvas::Canvas(QObject *parent)
 }
 
 Town *Canvas::townAt(int x, int y) {
-    QListIterator<Town*> it(m_towns);
-    it.toBack();
-    while (it.hasPrevious()) {
-        Town *prev = it.previous();
-        if (x - prev->x() < townSize() && x - prev->x() >= 0 && y - prev->y() < townSize() && y - prev->y() >= 0)
-            return prev;
-    }
+    // towns are indexed by their top left corner, the newest one is on top
+    const SpatialGrid<Town*>::Entry *top = nullptr;
+    m_grid.visit(x - townSize() + 1, y - townSize() + 1, x, y, [&top](const SpatialGrid<Town*>::Entry &e) {
+        if (!top || e.order > top->order)
+            top = &e;
+    });
+    return top ? top->item : nullptr;
+}
+
+Path *Canvas::pathBetween(Town *a, Town *b) {
+    for (Path *p : m_adjacency.value(a))
+        if (p->otherTown(a) == b && (!m_directed || p->townA() == a))
+            return p;
     return nullptr;
 }
 
-Path *Canvas::pathBetween(Town *_a, Town *_b) {
-    Town *a = _a, *b = _b;
-    if (b < a) {
-        a = _b;
-        b = _a;
-    }
-    for (Path *p : m_paths)
-        if (p->townA() == a && p->townB() == b)
-            return p;
-    return nullptr;
+int Canvas::indexOf(Town *t) {
+    return m_indices.value(t, -1);
+}
+
+QList<Path *> Canvas::pathsOf(Town *t) {
+    return m_adjacency.value(t);
+}
+
+QList<Town *> Canvas::nearest(Town *t, int k) {
+    return QList<Town*>::fromVector(m_grid.nearest(t->x(), t->y(), k, [t](Town *other) {
+        return other == t;
+    }));
 }
 
 QList<Town *> &Canvas::towns() {
@@ -522,34 +746,45 @@ bool Canvas::fillPaths() {
     return m_fillPaths;
 }
 
+bool Canvas::directed() {
+    return m_directed;
+}
+
 void Canvas::newTown(int x, int y) {
     Town *newTown = new Town(this, x, y);
+    m_indices.insert(newTown, m_towns.size());
     m_towns.append(newTown);
+    m_grid.insert(newTown, newTown->x(), newTown->y());
+    connect(newTown, &Town::xChanged, this, &Canvas::slotTownMoved);
+    connect(newTown, &Town::yChanged, this, &Canvas::slotTownMoved);
     emit townsChanged();
     if (m_fillPaths) {
         for (int i = 0; i < m_towns.size() - 1; i++) {
-            addPath(newTown, m_towns[i]);
+            createPath(newTown, m_towns[i]);
+            if (m_directed)
+                createPath(m_towns[i], newTown);
         }
     }
     emit pathsChanged();
 }
 
 void Canvas::deleteTown(Town *t) {
-    QList<Path *> toDelete;
-    for (Path *p : m_paths) {
-        if (p->townA() == t || p->townB() == t) {
-            toDelete.append(p);
-        }
-    }
+    QList<Path *> toDelete = m_adjacency.take(t);
     for (Path *p : toDelete) {
         disconnect(p, &Path::distanceChanged, this, &Canvas::distancesChanged);
+        m_adjacency[p->otherTown(t)].removeOne(p);
         p->deleteLater();
         m_paths.removeOne(p);
     }
     if (!toDelete.isEmpty())
         emit pathsChanged();
+    m_grid.remove(t);
     t->deleteLater();
     m_towns.removeOne(t);
+    // the towns after it moved one place back
+    m_indices.clear();
+    for (int i = 0; i < m_towns.size(); i++)
+        m_indices.insert(m_towns[i], i);
     emit townsChanged();
 }
 
@@ -561,54 +796,76 @@ void Canvas::togglePath(Town *a, Town *b) {
         addPath(a, b);
 }
 
-bool Canvas::addPath(Town *_a, Town *_b) {
-    Town *a = _a, *b = _b;
-    if (!a || !b || a == b)
+bool Canvas::addPath(Town *a, Town *b) {
+    if (!a || !b || a == b || pathBetween(a, b))
        return false;
-    if (b < a) {
-       a = _b;
-       b = _a;
-    }
-    Path *tmp = new Path(this, a, b);
-    connect(tmp, &Path::distanceChanged, this, &Canvas::distancesChanged);
-    m_paths.append(tmp);
+    createPath(a, b);
     emit pathsChanged();
     return true;
 }
 
-bool Canvas::removePath(Town *_a, Town *_b) {
-    Town *a = _a, *b = _b;
+bool Canvas::removePath(Town *a, Town *b) {
     if (!a || !b || a == b)
         return false;
-    if (b < a) {
-        a = _b;
-        b = _a;
-    }
-    Path *toDelete = nullptr;
-    for (Path *p : m_paths) {
-        if (p->townA() == a && p->townB() == b) {
-            toDelete = p;
-            break;
-        }
-    }
+    Path *toDelete = pathBetween(a, b);
     if (toDelete) {
-        disconnect(toDelete, &Path::distanceChanged, this, &Canvas::distancesChanged);
-        toDelete->deleteLater();
-        m_paths.removeOne(toDelete);
+        destroyPath(toDelete);
         emit pathsChanged();
         return true;
     }
     return false;
 }
 
+Path *Canvas::createPath(Town *a, Town *b) {
+    // paths of a symmetric canvas go from the lower address to the higher one
+    if (!m_directed && b < a)
+        qSwap(a, b);
+    Path *p = new Path(this, a, b);
+    connect(p, &Path::distanceChanged, this, &Canvas::distancesChanged);
+    m_paths.append(p);
+    m_adjacency[a].append(p);
+    m_adjacency[b].append(p);
+    return p;
+}
+
+void Canvas::destroyPath(Path *p) {
+    disconnect(p, &Path::distanceChanged, this, &Canvas::distancesChanged);
+    m_adjacency[p->townA()].removeOne(p);
+    m_adjacency[p->townB()].removeOne(p);
+    m_paths.removeOne(p);
+    p->deleteLater();
+}
+
 void Canvas::clear() {
-    while (m_towns.size() > 0)
-        deleteTown(m_towns.first());
+    // everything goes at once, the indices and the views are only updated once
+    QList<Path*> paths;
+    QList<Town*> towns;
+    paths.swap(m_paths);
+    towns.swap(m_towns);
+    m_indices.clear();
+    m_adjacency.clear();
+    m_grid.clear();
+    for (Path *p : paths) {
+        disconnect(p, &Path::distanceChanged, this, &Canvas::distancesChanged);
+        p->deleteLater();
+    }
+    for (Town *t : towns) {
+        disconnect(t, nullptr, this, nullptr);
+        t->deleteLater();
+    }
+    if (!paths.isEmpty())
+        emit pathsChanged();
+    if (!towns.isEmpty())
+        emit townsChanged();
 }
 
 void Canvas::setTownSize(int size) {
     if (m_townSize != size) {
         m_townSize = size;
+        // a town then overlaps at most four cells of the grid
+        m_grid = SpatialGrid<Town*>(qMax(1, size));
+        for (Town *t : m_towns)
+            m_grid.insert(t, t->x(), t->y());
         emit townSizeChanged();
     }
 }
@@ -623,10 +880,46 @@ void Canvas::setInitialTau(qreal tau) {
 void Canvas::setFillPaths(bool on) {
     if (m_fillPaths != on) {
         m_fillPaths = on;
-        emit fillPaths();
+        emit fillPathsChanged();
     }
 }
 
+void Canvas::setDirected(bool on) {
+    if (m_directed == on)
+        return;
+    m_directed = on;
+    QList<Path*> paths = m_paths;
+    for (Path *p : paths) {
+        Town *a = p->townA();
+        Town *b = p->townB();
+        Path *replacement = nullptr;
+        if (on) {
+            // every path gets a twin going the other way
+            replacement = createPath(b, a);
+        }
+        else if (b < a) {
+            // keep one path per pair of towns, going from the lower address
+            Path *twin = nullptr;
+            for (Path *q : m_adjacency.value(a))
+                if (q != p && q->otherTown(a) == b)
+                    twin = q;
+            if (!twin)
+                replacement = createPath(a, b);
+            destroyPath(p);
+        }
+        if (replacement && p->explicitDistance())
+            replacement->setDistance(p->distance());
+    }
+    emit directedChanged();
+    emit pathsChanged();
+}
+
+void Canvas::slotTownMoved() {
+    Town *t = qobject_cast<Town*>(sender());
+    if (t)
+        m_grid.move(t, t->x(), t->y());
+}
+
 qreal Canvas::setAnimationSpeed(qreal newSpeed) {
     if (m_animationSpeed != newSpeed) {
         m_animationSpeed = newSpeed;
@@ -641,17 +934,19 @@ qreal Canvas::setAnimationSpeed(qreal newSpeed) {
 //
 
 Aco::Aco(QObject *parent)
-    : Canvas(parent), m_currentAlgorithm(new Algorithm(this)) {
+    : Canvas(parent), m_currentAlgorithm(new Algorithm(this)), m_islands(new IslandModel(this)), m_replay(new Replay(this)) {
 }
 
 QString Aco::string() {
     QString res;
+    if (m_directed)
+        res.append("directed\n");
     for (Town *t : m_towns) {
         res.append(QString("%1;%2;%3\n").arg(t->x()).arg(t->y()).arg(t->name()));
     }
     for(Path *p : m_paths) {
-        int a = m_towns.indexOf(p->townA());
-        int b = m_towns.indexOf(p->townB());
+        int a = indexOf(p->townA());
+        int b = indexOf(p->townB());
         if (a >= 0 && b >= 0)
             res.append(QString("%1;%2;%3;%4\n").arg(a).arg(b).arg(p->distance()).arg(p->trail()));
     }
@@ -665,22 +960,115 @@ void Aco::saveTo(const QUrl &file) {
     f.close();
 }
 
-void Aco::loadFrom(const QUrl &file) {
-    Canvas::clear();
+void Aco::savePreset(const QUrl &file) {
+    QFile f(file.toLocalFile());
+    f.open(QIODevice::WriteOnly);
+    f.write(QJsonDocument(Parameters::fromAlgorithm(algorithm()).toJson()).toJson());
+    f.close();
+}
+
+bool Aco::loadPreset(const QUrl &file) {
+    QFile f(file.toLocalFile());
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(f.readAll(), &error);
+    if (!document.isObject()) {
+        qWarning() << "Can't load preset" << file << error.errorString();
+        return false;
+    }
+    Parameters::fromJson(document.object(), Parameters::fromAlgorithm(algorithm())).applyTo(algorithm());
+    return true;
+}
+
+bool Aco::loadFrom(const QUrl &file) {
     QFile f(file.toLocalFile());
-    f.open(QIODevice::ReadOnly);
-    while (!f.atEnd()) {
-        QString s = f.readLine();
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Can't open" << file << f.errorString();
+        return false;
+    }
+    QByteArray data = f.readAll();
+    f.close();
+    Canvas::clear();
+
+    Tsplib tsplib;
+    if (Tsplib::parse(data, tsplib)) {
+        loadTsplib(tsplib);
+        return true;
+    }
+    if (!tsplib.error.isEmpty()) {
+        qWarning() << "Can't load" << file << tsplib.error;
+        return false;
+    }
+
+    // the file lists all the paths, don't let newTown() make up its own
+    bool fill = m_fillPaths;
+    m_fillPaths = false;
+    setDirected(false);
+    for (const QByteArray &line : data.split('\n')) {
+        QString s = QString::fromLocal8Bit(line).trimmed();
         QStringList sL = s.split(";");
+        if (s == "directed") {
+            setDirected(true);
+        }
         if (sL.length() == 3) {
             newTown(sL[0].toInt(), sL[1].toInt());
             m_towns.last()->setName(sL[2]);
         }
         if (sL.length() == 4) {
-            pathBetween(m_towns[sL[0].toInt()], m_towns[sL[1].toInt()])->setDistance(sL[2].toFloat());
+            Town *a = m_towns.value(sL[0].toInt());
+            Town *b = m_towns.value(sL[1].toInt());
+            addPath(a, b);
+            if (Path *p = pathBetween(a, b))
+                p->setDistance(sL[2].toFloat());
         }
     }
-    f.close();
+    m_fillPaths = fill;
+    return true;
+}
+
+void Aco::loadTsplib(const Tsplib &tsplib) {
+    Canvas::clear();
+    bool fill = m_fillPaths;
+    m_fillPaths = true;
+    setDirected(!tsplib.symmetric);
+
+    const int n = tsplib.instance.size();
+    const int margin = m_townSize;
+    const int extent = 2000 - 3 * m_townSize;
+    if (tsplib.x.size() == n) {
+        // fit the map into the default scene, geographical coordinates are latitude first
+        QVector<qreal> xs = tsplib.metric == Tsplib::Geographic ? tsplib.y : tsplib.x;
+        QVector<qreal> ys = tsplib.x;
+        if (tsplib.metric == Tsplib::Geographic) {
+            for (qreal &y : ys)
+                y = -y;
+        }
+        else {
+            ys = tsplib.y;
+        }
+        qreal minX = *std::min_element(xs.begin(), xs.end());
+        qreal maxX = *std::max_element(xs.begin(), xs.end());
+        qreal minY = *std::min_element(ys.begin(), ys.end());
+        qreal maxY = *std::max_element(ys.begin(), ys.end());
+        qreal scale = extent / qMax(1e-9, qMax(maxX - minX, maxY - minY));
+        for (int i = 0; i < n; i++)
+            newTown(margin + (xs[i] - minX) * scale, margin + (ys[i] - minY) * scale);
+    }
+    else {
+        // no coordinates, put the towns on a circle
+        for (int i = 0; i < n; i++) {
+            qreal angle = 2 * M_PI * i / n;
+            newTown(margin + extent / 2 * (1 + cos(angle)), margin + extent / 2 * (1 + sin(angle)));
+        }
+    }
+    for (int a = 0; a < n; a++) {
+        for (int b = m_directed ? 0 : a + 1; b < n; b++) {
+            if (Path *p = pathBetween(m_towns[a], m_towns[b]))
+                p->setDistance(tsplib.instance.distance(a, b));
+        }
+    }
+    m_fillPaths = fill;
 }
 
 qreal Aco::getRand() {
@@ -691,6 +1079,14 @@ Algorithm *Aco::algorithm() {
     return m_currentAlgorithm;
 }
 
+IslandModel *Aco::islands() {
+    return m_islands;
+}
+
+Replay *Aco::replay() {
+    return m_replay;
+}
+
 Canvas *Aco::canvas() {
     return this;
 }
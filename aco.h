@@ -26,6 +26,7 @@
 #define ACO_H
 
 #include <QDebug>
+#include <QHash>
 #include <QObject>
 #include <QQmlListProperty>
 #include <QUrl>
@@ -33,12 +34,17 @@
 
 #include <random>
 
+#include "islands.h"
+#include "replay.h"
+#include "spatialgrid.h"
+
 class Aco;
 class Town;
 class Path;
 class Ant;
 class Canvas;
 class Algorithm;
+class Tsplib;
 
 class Ant : public QObject {
     Q_OBJECT
@@ -56,6 +62,7 @@ public:
     Q_INVOKABLE void step();
     Q_INVOKABLE void reset(Town *t);
     Q_INVOKABLE qreal tripLength();
+    Q_INVOKABLE bool complete();
 
     Town *town();
     Town *firstTown();
@@ -63,7 +70,9 @@ public:
     int y();
     QQmlListProperty<Town> tabooListProperty();
     QQmlListProperty<Path> tripListProperty();
-    QList<Path*> trip();
+    const QList<Path*> &trip();
+    const QVector<int> &tripTowns();
+    QList<Town*> taboo();
 public slots:
     void setTown(Town *town);
 signals:
@@ -72,9 +81,21 @@ signals:
     void yChanged();
     void tabooChanged();
     void tripChanged();
+private slots:
+    void invalidateTrip();
+    void invalidateTripLength();
 private:
+    void visit(Town *town);
+
     Town *m_town { nullptr };
     QList<Town*> m_taboo { };
+    // the same towns by their index in Canvas::towns()
+    QVector<int> m_tripTowns { };
+    QVector<bool> m_visited { };
+    // the paths and the length are looked up the first time they're asked for
+    QList<Path*> m_trip { };
+    bool m_tripValid { false };
+    qreal m_tripLength { -1.0 };
 };
 
 class Town : public QObject {
@@ -119,6 +140,8 @@ public:
     Canvas *canvas();
     Town *townA();
     Town *townB();
+    Town *otherTown(Town *t);
+    bool explicitDistance();
     qreal distance();
     qreal trail();
 public slots:
@@ -142,12 +165,16 @@ class Canvas : public QObject {
     Q_PROPERTY(QQmlListProperty<Town> towns READ townsListProperty NOTIFY townsChanged)
     Q_PROPERTY(QQmlListProperty<Path> paths READ pathsListProperty NOTIFY pathsChanged)
     Q_PROPERTY(bool fillPaths READ fillPaths WRITE setFillPaths NOTIFY fillPathsChanged)
+    Q_PROPERTY(bool directed READ directed WRITE setDirected NOTIFY directedChanged)
     Q_PROPERTY(qreal initialTau READ initialTau WRITE setInitialTau NOTIFY initialTauChanged)
     Q_PROPERTY(qreal animationSpeed READ animationSpeed WRITE setAnimationSpeed NOTIFY animationSpeedChanged)
 public:
     Canvas(QObject *parent);
     Q_INVOKABLE Town *townAt(int x, int y);
     Q_INVOKABLE Path *pathBetween(Town *a, Town *b);
+    int indexOf(Town *t);
+    QList<Path*> pathsOf(Town *t);
+    QList<Town*> nearest(Town *t, int k);
 
     int townSize();
     QList<Town*> &towns();
@@ -157,6 +184,7 @@ public:
     qreal initialTau();
     qreal animationSpeed();
     bool fillPaths();
+    bool directed();
 
 public slots:
     void newTown(int x, int y);
@@ -169,6 +197,7 @@ public slots:
     void setTownSize(int size);
     void setInitialTau(qreal tau);
     void setFillPaths(bool on);
+    void setDirected(bool on);
     qreal setAnimationSpeed(qreal newSpeed);
 signals:
     void topologyChanged();
@@ -179,13 +208,23 @@ signals:
     void townSizeChanged();
     void initialTauChanged();
     void fillPathsChanged();
+    void directedChanged();
     void animationSpeedChanged();
+private slots:
+    void slotTownMoved();
 protected:
+    Path *createPath(Town *a, Town *b);
+    void destroyPath(Path *p);
+
     int m_townSize { 40 };
     QList<Town*> m_towns { };
+    QHash<Town*, int> m_indices { };
     QList<Path*> m_paths { };
+    QHash<Town*, QList<Path*>> m_adjacency { };
+    SpatialGrid<Town*> m_grid { 40.0 };
     qreal m_initialTau { 1 };
     bool m_fillPaths { true };
+    bool m_directed { false };
     qreal m_animationSpeed { 100.0 };
 };
 
@@ -202,6 +241,12 @@ class Algorithm : public QObject {
     Q_PROPERTY(qreal q READ q WRITE setQ NOTIFY qChanged)
     Q_PROPERTY(qreal ro READ ro WRITE setRo NOTIFY roChanged)
     Q_PROPERTY(qreal e READ e WRITE setE NOTIFY eChanged)
+    Q_PROPERTY(qreal restartBranching READ restartBranching WRITE setRestartBranching NOTIFY restartBranchingChanged)
+    Q_PROPERTY(int restartIdle READ restartIdle WRITE setRestartIdle NOTIFY restartIdleChanged)
+    Q_PROPERTY(qreal branching READ branching NOTIFY convergenceChanged)
+    Q_PROPERTY(qreal entropy READ entropy NOTIFY convergenceChanged)
+    Q_PROPERTY(int idleCycles READ idleCycles NOTIFY convergenceChanged)
+    Q_PROPERTY(int restarts READ restarts NOTIFY convergenceChanged)
     Q_PROPERTY(QQmlListProperty<Path> shortestTrip READ shortestTripProperty NOTIFY shortestTripChanged)
 public:
     Algorithm(Aco *parent);
@@ -220,7 +265,17 @@ public:
     qreal q();
     qreal ro();
     qreal e();
+    qreal restartBranching();
+    int restartIdle();
+    qreal branching();
+    qreal entropy();
+    int idleCycles();
+    int restarts();
     QQmlListProperty<Path> shortestTripProperty();
+    // trips by town index, offerTrip() only takes shorter ones
+    void offerTrip(const QVector<int> &trip, qreal length);
+    void setShortestTrip(const QVector<int> &trip, qreal length);
+    void clearShortestTrip();
 public slots:
     void reset();
     void roundInit();
@@ -234,6 +289,9 @@ public slots:
     void setQ(qreal q);
     void setRo(qreal ro);
     void setE(qreal e);
+    void setRestartBranching(qreal branching);
+    void setRestartIdle(int cycles);
+    void restartTrails();
 private slots:
     void slotDistancesChanged();
 signals:
@@ -248,8 +306,13 @@ signals:
     void qChanged();
     void roChanged();
     void eChanged();
+    void restartBranchingChanged();
+    void restartIdleChanged();
+    void convergenceChanged();
     void shortestTripChanged();
 protected:
+    void measureConvergence();
+
     int m_c { 0 };
     int m_s { 0 };
     int m_t { 0 };
@@ -259,6 +322,11 @@ protected:
     qreal m_q { 20.0 };
     qreal m_ro { 0.1 };
     qreal m_e { 2 };
+    qreal m_restartBranching { 0.0 };
+    int m_restartIdle { 0 };
+    int m_lastImprovement { 0 };
+    int m_lastRestart { 0 };
+    Convergence m_convergence { };
 
     QList<Ant*> m_ants { };
     QList<Path*> m_shortestTrip { };
@@ -277,6 +345,8 @@ class Aco : public Canvas {
     Q_OBJECT
     Q_PROPERTY(Canvas *canvas READ canvas NOTIFY canvasChanged)
     Q_PROPERTY(Algorithm *algorithm READ algorithm NOTIFY algorithmChanged)
+    Q_PROPERTY(IslandModel *islands READ islands NOTIFY islandsChanged)
+    Q_PROPERTY(Replay *replay READ replay NOTIFY replayChanged)
     Q_PROPERTY(int chosenAlgo READ chosenAlgo WRITE setChosenAlgo NOTIFY chosenAlgoChanged)
 public:
     enum Algorithms {
@@ -290,10 +360,15 @@ public:
     Aco(QObject *parent = 0);
     Q_INVOKABLE QString string();
     Q_INVOKABLE void saveTo(const QUrl &file);
-    Q_INVOKABLE void loadFrom(const QUrl &file);
+    Q_INVOKABLE bool loadFrom(const QUrl &file);
+    Q_INVOKABLE void savePreset(const QUrl &file);
+    Q_INVOKABLE bool loadPreset(const QUrl &file);
+    void loadTsplib(const Tsplib &tsplib);
     Q_INVOKABLE qreal getRand();
 
     Algorithm *algorithm();
+    IslandModel *islands();
+    Replay *replay();
     Canvas *canvas();
     int chosenAlgo();
 
@@ -302,12 +377,16 @@ public slots:
 private slots:
 signals:
     void algorithmChanged();
+    void islandsChanged();
+    void replayChanged();
     void canvasChanged();
     void chosenAlgoChanged();
 private:
     std::mt19937 m_mersenneTwister { (long unsigned int) time(0) };
     std::uniform_real_distribution<qreal> m_uniformDist { 0.0, 1.0 };
     Algorithm *m_currentAlgorithm { nullptr };
+    IslandModel *m_islands { nullptr };
+    Replay *m_replay { nullptr };
     Algorithms m_chosenAlgo { AntCycle };
 };
 
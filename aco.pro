@@ -1,11 +1,25 @@
 TEMPLATE = app
 
-QT += qml quick widgets
+QT += qml quick widgets concurrent network
 
 CONFIG += c++11
 
 SOURCES += main.cpp \
-    aco.cpp
+    aco.cpp \
+    arena.cpp \
+    batch.cpp \
+    closure.cpp \
+    colony.cpp \
+    decomposition.cpp \
+    islands.cpp \
+    node.cpp \
+    recorder.cpp \
+    replay.cpp \
+    service.cpp \
+    solver.cpp \
+    transport.cpp \
+    tsplib.cpp \
+    tuner.cpp
 
 RESOURCES += qml.qrc
 
@@ -16,4 +30,19 @@ QML_IMPORT_PATH =
 include(deployment.pri)
 
 HEADERS += \
-    aco.h
+    aco.h \
+    arena.h \
+    batch.h \
+    closure.h \
+    colony.h \
+    decomposition.h \
+    islands.h \
+    node.h \
+    recorder.h \
+    replay.h \
+    service.h \
+    solver.h \
+    spatialgrid.h \
+    transport.h \
+    tsplib.h \
+    tuner.h
@@ -0,0 +1,78 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "arena.h"
+
+Arena::Arena(size_t capacity) {
+    reserve(capacity);
+}
+
+Arena::~Arena() {
+    reset();
+    qFreeAligned(m_block);
+}
+
+size_t Arena::capacity() const {
+    return m_capacity;
+}
+
+size_t Arena::used() const {
+    return m_used + m_overflowSize;
+}
+
+void Arena::reserve(size_t capacity) {
+    if (capacity <= m_capacity)
+        return;
+    // whatever was allocated from the old block is gone
+    reset();
+    qFreeAligned(m_block);
+    m_block = static_cast<char*>(qMallocAligned(capacity, alignment));
+    m_capacity = m_block ? capacity : 0;
+}
+
+void Arena::reset() {
+    for (void *block : m_overflow)
+        qFreeAligned(block);
+    m_overflow.clear();
+    m_used = 0;
+    if (m_overflowSize > 0) {
+        size_t capacity = m_capacity + m_overflowSize;
+        m_overflowSize = 0;
+        reserve(capacity);
+    }
+}
+
+void *Arena::allocateBytes(size_t size) {
+    if (m_used + size <= m_capacity) {
+        void *ret = m_block + m_used;
+        m_used += size;
+        return ret;
+    }
+    void *block = qMallocAligned(size, alignment);
+    m_overflow.append(block);
+    m_overflowSize += size;
+    return block;
+}
@@ -0,0 +1,79 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#include <cstddef>
+
+/**
+ * Bump allocator for the state of a solver. Everything is carved out of
+ * a single block, aligned to cache lines, and released at once by reset()
+ * or by destroying the arena. Nothing is initialized, so the pages of the
+ * block are first written by the thread that uses them and the system
+ * places them on its memory node.
+ *
+ * Allocations that don't fit get blocks of their own, the next reset()
+ * then merges them into one block big enough for all of them.
+ */
+class Arena {
+public:
+    static const size_t alignment = 64;
+
+    Arena(size_t capacity = 0);
+    ~Arena();
+
+    size_t capacity() const;
+    size_t used() const;
+    void reserve(size_t capacity);
+    void reset();
+
+    // room taken by count objects of type T, including the padding
+    template<typename T>
+    static size_t sizeOf(size_t count) {
+        return (count * sizeof(T) + alignment - 1) / alignment * alignment;
+    }
+
+    template<typename T>
+    T *allocate(size_t count) {
+        return static_cast<T*>(allocateBytes(sizeOf<T>(count)));
+    }
+private:
+    Q_DISABLE_COPY(Arena)
+
+    void *allocateBytes(size_t size);
+
+    char *m_block { nullptr };
+    size_t m_capacity { 0 };
+    size_t m_used { 0 };
+    QVector<void*> m_overflow { };
+    size_t m_overflowSize { 0 };
+};
+
+#endif // ARENA_H
@@ -0,0 +1,162 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "batch.h"
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+Batch::Batch(const Parameters &parameters, quint32 seed)
+    : m_parameters(parameters), m_seed(seed) {
+}
+
+int Batch::add(const Instance &instance) {
+    const int n = instance.size();
+    m_offsets.append(m_distances.size());
+    m_sizes.append(n);
+    m_symmetric.append(instance.symmetric());
+    m_distances.resize(m_distances.size() + n * n);
+    qreal *matrix = m_distances.data() + m_offsets.last();
+    if (instance.matrix()) {
+        std::copy(instance.matrix(), instance.matrix() + n * n, matrix);
+    }
+    else {
+        for (int from = 0; from < n; from++)
+            for (int to = 0; to < n; to++)
+                matrix[from * n + to] = instance.distance(from, to);
+    }
+    return m_sizes.size() - 1;
+}
+
+int Batch::size() const {
+    return m_sizes.size();
+}
+
+int Batch::towns(int index) const {
+    return m_sizes[index];
+}
+
+Instance Batch::instance(int index) const {
+    return Instance::fromMatrix(m_sizes[index], m_distances.constData() + m_offsets[index], m_symmetric[index]);
+}
+
+void Batch::clear() {
+    m_distances.clear();
+    m_offsets.clear();
+    m_sizes.clear();
+    m_symmetric.clear();
+}
+
+qint64 Batch::timeout() const {
+    return m_timeout;
+}
+
+int Batch::stagnationLimit() const {
+    return m_stagnationLimit;
+}
+
+int Batch::maxCycles() const {
+    return m_maxCycles;
+}
+
+void Batch::setTimeout(qint64 timeout) {
+    m_timeout = timeout;
+}
+
+void Batch::setStagnationLimit(int cycles) {
+    m_stagnationLimit = qMax(0, cycles);
+}
+
+void Batch::setMaxCycles(int cycles) {
+    m_maxCycles = qMax(0, cycles);
+}
+
+QVector<Solver::Result> Batch::solve(int threads, QThreadPool *pool) {
+    const int count = size();
+    QVector<Solver::Result> results(count);
+    if (count == 0)
+        return results;
+
+    // the biggest instances go first so no thread is left with a big one at the end
+    QVector<int> order(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return m_sizes[a] > m_sizes[b];
+    });
+
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    QAtomicInt next(0);
+    auto work = [&]() {
+        // one arena per thread, the biggest instance comes first so it hardly ever grows
+        Arena arena;
+        for (int i = next.fetchAndAddRelaxed(1); i < count && !m_cancelled.load(); i = next.fetchAndAddRelaxed(1)) {
+            int index = order[i];
+            Instance instance = this->instance(index);
+            instance.buildNeighbours(Instance::defaultNeighbourCount);
+            arena.reset();
+            arena.reserve(Colony::arenaSize(&instance, m_parameters));
+            Solver solver(m_parameters, m_seed + index);
+            solver.setArena(&arena);
+            solver.setStagnationLimit(m_stagnationLimit);
+            solver.setMaxCycles(m_maxCycles);
+            {
+                QMutexLocker locker(&m_mutex);
+                if (m_cancelled.load())
+                    break;
+                m_solvers.append(&solver);
+            }
+            results[index] = solver.solve(instance, m_timeout);
+            QMutexLocker locker(&m_mutex);
+            m_solvers.removeOne(&solver);
+        }
+    };
+    QList<QFuture<void>> helpers;
+    for (int i = 1; i < qMin(threads, count); i++)
+        helpers.append(QtConcurrent::run(pool, work));
+    work();
+    for (QFuture<void> &helper : helpers)
+        helper.waitForFinished();
+    if (m_cancelled.load()) {
+        for (Solver::Result &result : results) {
+            if (result.trip.isEmpty())
+                result.stopReason = Solver::Cancelled;
+        }
+    }
+    m_cancelled.store(0);
+    return results;
+}
+
+void Batch::cancel() {
+    QMutexLocker locker(&m_mutex);
+    m_cancelled.store(1);
+    for (Solver *solver : m_solvers)
+        solver->cancel();
+}
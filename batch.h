@@ -0,0 +1,86 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QThreadPool>
+#include <QVector>
+
+#include "colony.h"
+#include "solver.h"
+
+/**
+ * Many small instances solved at once. The distance matrices of all of
+ * them are packed one after another into a single block and every
+ * instance is solved by a single thread, the threads take the next
+ * unsolved instance as soon as they're done with the previous one. The
+ * thread calling solve() works on them too.
+ *
+ * The results come back in the order the instances were added. Instances
+ * can't be added while solve() is running.
+ */
+class Batch {
+public:
+    Batch(const Parameters &parameters = Parameters(), quint32 seed = 0);
+
+    int add(const Instance &instance);
+    int size() const;
+    int towns(int index) const;
+    Instance instance(int index) const;
+    void clear();
+
+    // limits of a single instance, as in Solver
+    qint64 timeout() const;
+    int stagnationLimit() const;
+    int maxCycles() const;
+    void setTimeout(qint64 timeout);
+    void setStagnationLimit(int cycles);
+    void setMaxCycles(int cycles);
+
+    QVector<Solver::Result> solve(int threads = 0, QThreadPool *pool = QThreadPool::globalInstance());
+    // instances that haven't been started yet are left unsolved, the running ones stop after their cycle
+    void cancel();
+private:
+    Parameters m_parameters { };
+    quint32 m_seed { 0 };
+    qint64 m_timeout { -1 };
+    int m_stagnationLimit { 0 };
+    int m_maxCycles { 100 };
+    QAtomicInt m_cancelled { 0 };
+    QMutex m_mutex { };
+    QList<Solver*> m_solvers { };
+
+    QVector<qreal> m_distances { };
+    QVector<int> m_offsets { };
+    QVector<int> m_sizes { };
+    QVector<bool> m_symmetric { };
+};
+
+#endif // BATCH_H
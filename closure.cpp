@@ -0,0 +1,106 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "closure.h"
+
+#include <QtConcurrent>
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+Closure::Closure(const Instance *graph)
+    : m_graph(graph), m_instance(graph->size()) {
+    QVector<int> sources(graph->size());
+    for (int i = 0; i < sources.size(); i++)
+        sources[i] = i;
+    // detach the matrix before the rows get written from several threads
+    m_instance.row(0);
+    QtConcurrent::blockingMap(sources, [this](int from) {
+        dijkstra(from, -1, m_instance.row(from), nullptr);
+        // the diagonal stays infinite so a town is never its own neighbour
+        m_instance.row(from)[from] = HUGE_VAL;
+    });
+    m_instance.buildNeighbours(Instance::defaultNeighbourCount);
+}
+
+const Instance *Closure::graph() const {
+    return m_graph;
+}
+
+const Instance *Closure::instance() const {
+    return &m_instance;
+}
+
+QVector<int> Closure::expand(const QVector<int> &trip) const {
+    QVector<int> route;
+    QVector<qreal> distances(m_graph->size());
+    QVector<int> previous(m_graph->size());
+    for (int i = 0; i < trip.size(); i++) {
+        int from = trip[i];
+        int to = trip[(i + 1) % trip.size()];
+        if (m_graph->distance(from, to) <= m_instance.distance(from, to)) {
+            route.append(from);
+            continue;
+        }
+        dijkstra(from, to, distances.data(), previous.data());
+        if (distances[to] == HUGE_VAL)
+            return QVector<int>();
+        QVector<int> path;
+        for (int t = previous[to]; t != from; t = previous[t])
+            path.prepend(t);
+        route.append(from);
+        route += path;
+    }
+    return route;
+}
+
+void Closure::dijkstra(int from, int to, qreal *distances, int *previous) const {
+    typedef std::pair<qreal, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+    std::fill(distances, distances + m_graph->size(), HUGE_VAL);
+    distances[from] = 0.0;
+    queue.push(Entry(0.0, from));
+    while (!queue.empty()) {
+        Entry top = queue.top();
+        queue.pop();
+        int current = top.second;
+        if (top.first > distances[current])
+            continue;
+        if (current == to)
+            return;
+        for (int e = m_graph->edgesBegin(current); e < m_graph->edgesEnd(current); e++) {
+            int t = m_graph->edgeTown(e);
+            qreal distance = distances[current] + m_graph->edgeDistance(e);
+            if (distance < distances[t]) {
+                distances[t] = distance;
+                if (previous)
+                    previous[t] = current;
+                queue.push(Entry(distance, t));
+            }
+        }
+    }
+}
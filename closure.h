@@ -0,0 +1,55 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef CLOSURE_H
+#define CLOSURE_H
+
+#include <QVector>
+
+#include "colony.h"
+
+/**
+ * Metric closure of a sparse instance: a dense instance over the same towns
+ * where every distance is the length of the shortest path in the original
+ * graph. The rows are computed by Dijkstra's algorithm from every town in
+ * parallel. The paths themselves are not stored, expand() looks them up
+ * again for the one trip that is going to be shown.
+ */
+class Closure {
+public:
+    Closure(const Instance *graph);
+
+    const Instance *graph() const;
+    const Instance *instance() const;
+
+    QVector<int> expand(const QVector<int> &trip) const;
+private:
+    void dijkstra(int from, int to, qreal *distances, int *previous) const;
+
+    const Instance *m_graph { nullptr };
+    Instance m_instance { };
+};
+
+#endif // CLOSURE_H
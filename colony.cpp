@@ -0,0 +1,765 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "colony.h"
+#include "aco.h"
+
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+////////////////
+//                  INSTANCE
+//
+
+Instance::Instance(int size)
+    : m_size(size), m_distances(size * size, HUGE_VAL) {
+}
+
+Instance Instance::fromEdges(int size, const QVector<Edge> &edges, bool sparse) {
+    if (!sparse) {
+        Instance instance(size);
+        for (const Edge &e : edges)
+            instance.setDistance(e.from, e.to, e.distance);
+        return instance;
+    }
+
+    Instance instance;
+    instance.m_size = size;
+    instance.m_sparse = true;
+    instance.m_offsets.fill(0, size + 1);
+    for (const Edge &e : edges)
+        instance.m_offsets[e.from + 1]++;
+    for (int i = 0; i < size; i++)
+        instance.m_offsets[i + 1] += instance.m_offsets[i];
+
+    QVector<Edge> sorted = edges;
+    std::sort(sorted.begin(), sorted.end(), [](const Edge &a, const Edge &b) {
+        return a.from < b.from || (a.from == b.from && a.to < b.to);
+    });
+    instance.m_towns.reserve(sorted.size());
+    instance.m_edgeDistances.reserve(sorted.size());
+    for (const Edge &e : sorted) {
+        instance.m_towns.append(e.to);
+        instance.m_edgeDistances.append(e.distance);
+    }
+    return instance;
+}
+
+Instance Instance::fromMatrix(int size, const qreal *distances, bool symmetric) {
+    Instance instance;
+    instance.m_size = size;
+    instance.m_symmetric = symmetric;
+    instance.m_matrix = distances;
+    return instance;
+}
+
+Instance Instance::fromCanvas(Canvas *canvas) {
+    QList<Town*> &towns = canvas->towns();
+
+    QVector<Edge> edges;
+    edges.reserve(canvas->paths().size() * 2);
+    bool geometric = true;
+    for (Path *p : canvas->paths()) {
+        int a = canvas->indexOf(p->townA());
+        int b = canvas->indexOf(p->townB());
+        if (p->explicitDistance())
+            geometric = false;
+        if (a >= 0 && b >= 0) {
+            edges.append({ a, b, p->distance() });
+            if (!canvas->directed())
+                edges.append({ b, a, p->distance() });
+        }
+    }
+    // a matrix is only worth it when at least half of the towns are connected
+    int pairs = towns.size() * (towns.size() - 1) / 2;
+    bool sparse = edges.size() < pairs;
+    Instance instance = fromEdges(towns.size(), edges, sparse);
+    instance.setSymmetric(!canvas->directed());
+
+    // distances follow the positions of the towns, the grid of the canvas finds the closest ones without the matrix
+    if (geometric && !sparse) {
+        int k = qMin(defaultNeighbourCount, towns.size() - 1);
+        QVector<int> neighbours(towns.size() * k, -1);
+        for (int i = 0; i < towns.size(); i++) {
+            int j = 0;
+            for (Town *t : canvas->nearest(towns[i], k)) {
+                int to = canvas->indexOf(t);
+                if (to >= 0 && instance.connected(i, to))
+                    neighbours[i * k + j++] = to;
+            }
+        }
+        instance.setNeighbours(k, neighbours);
+    }
+    else {
+        instance.buildNeighbours(defaultNeighbourCount);
+    }
+    return instance;
+}
+
+int Instance::size() const {
+    return m_size;
+}
+
+bool Instance::sparse() const {
+    return m_sparse;
+}
+
+bool Instance::symmetric() const {
+    return m_symmetric;
+}
+
+void Instance::setSymmetric(bool symmetric) {
+    m_symmetric = symmetric;
+}
+
+int Instance::neighbourCount() const {
+    return m_neighbourCount;
+}
+
+const int *Instance::neighbours(int town) const {
+    return m_neighbours.constData() + town * m_neighbourCount;
+}
+
+void Instance::setNeighbours(int count, const QVector<int> &neighbours) {
+    m_neighbourCount = qMax(0, count);
+    m_neighbours = neighbours;
+    m_neighbours.resize(m_size * m_neighbourCount);
+}
+
+void Instance::buildNeighbours(int count) {
+    m_neighbourCount = qMax(0, qMin(count, m_size - 1));
+    m_neighbours.fill(-1, m_size * m_neighbourCount);
+    QVector<int> row;
+    for (int town = 0; town < m_size; town++) {
+        row.resize(0);
+        for (int e = edgesBegin(town); e < edgesEnd(town); e++) {
+            if (edgeTown(e) != town && edgeDistance(e) != HUGE_VAL)
+                row.append(e);
+        }
+        int k = qMin(m_neighbourCount, row.size());
+        std::partial_sort(row.begin(), row.begin() + k, row.end(), [this](int a, int b) {
+            return edgeDistance(a) < edgeDistance(b);
+        });
+        for (int i = 0; i < k; i++)
+            m_neighbours[town * m_neighbourCount + i] = edgeTown(row[i]);
+    }
+}
+
+qreal Instance::distance(int from, int to) const {
+    if (!m_sparse)
+        return matrix()[from * m_size + to];
+    int e = edge(from, to);
+    return e < 0 ? HUGE_VAL : m_edgeDistances[e];
+}
+
+bool Instance::connected(int from, int to) const {
+    return edge(from, to) >= 0;
+}
+
+void Instance::setDistance(int from, int to, qreal distance) {
+    if (!m_sparse) {
+        detach();
+        m_distances[from * m_size + to] = distance;
+        return;
+    }
+    int e = edge(from, to);
+    if (e >= 0)
+        m_edgeDistances[e] = distance;
+}
+
+qreal *Instance::row(int town) {
+    if (m_sparse)
+        return nullptr;
+    detach();
+    return m_distances.data() + town * m_size;
+}
+
+const qreal *Instance::matrix() const {
+    if (m_sparse)
+        return nullptr;
+    return m_matrix ? m_matrix : m_distances.constData();
+}
+
+int Instance::edgeCount() const {
+    return m_sparse ? m_towns.size() : m_size * m_size;
+}
+
+int Instance::edge(int from, int to) const {
+    if (from == to)
+        return -1;
+    if (!m_sparse)
+        return matrix()[from * m_size + to] < HUGE_VAL ? from * m_size + to : -1;
+    auto begin = m_towns.constBegin() + m_offsets[from];
+    auto end = m_towns.constBegin() + m_offsets[from + 1];
+    auto it = std::lower_bound(begin, end, to);
+    return it != end && *it == to ? int(it - m_towns.constBegin()) : -1;
+}
+
+int Instance::edgesBegin(int town) const {
+    return m_sparse ? m_offsets[town] : town * m_size;
+}
+
+int Instance::edgesEnd(int town) const {
+    return m_sparse ? m_offsets[town + 1] : (town + 1) * m_size;
+}
+
+int Instance::edgeTown(int edge) const {
+    return m_sparse ? m_towns[edge] : edge % m_size;
+}
+
+qreal Instance::edgeDistance(int edge) const {
+    return m_sparse ? m_edgeDistances[edge] : matrix()[edge];
+}
+
+const int *Instance::edgeTowns() const {
+    return m_sparse ? m_towns.constData() : nullptr;
+}
+
+const qreal *Instance::edgeDistances() const {
+    return m_sparse ? m_edgeDistances.constData() : matrix();
+}
+
+void Instance::detach() {
+    if (m_matrix) {
+        m_distances = QVector<qreal>(m_size * m_size);
+        std::copy(m_matrix, m_matrix + m_size * m_size, m_distances.begin());
+        m_matrix = nullptr;
+    }
+}
+
+
+////////////////
+//                  PARAMETERS
+//
+
+Parameters Parameters::fromAlgorithm(Algorithm *algorithm) {
+    Parameters p;
+    p.algorithm = algorithm->aco()->chosenAlgo();
+    p.antCount = algorithm->antCount();
+    p.alpha = algorithm->alpha();
+    p.beta = algorithm->beta();
+    p.q = algorithm->q();
+    p.ro = algorithm->ro();
+    p.e = algorithm->e();
+    p.initialTau = algorithm->aco()->initialTau();
+    p.restartBranching = algorithm->restartBranching();
+    p.restartIdle = algorithm->restartIdle();
+    return p;
+}
+
+Parameters Parameters::fromJson(const QJsonObject &json) {
+    return fromJson(json, Parameters());
+}
+
+Parameters Parameters::fromJson(const QJsonObject &json, const Parameters &defaults) {
+    Parameters p = defaults;
+    p.algorithm = qBound(0, json.value("algorithm").toInt(p.algorithm), int(Aco::ElitistStrategy));
+    p.antCount = qMax(1, json.value("antCount").toInt(p.antCount));
+    p.alpha = json.value("alpha").toDouble(p.alpha);
+    p.beta = json.value("beta").toDouble(p.beta);
+    p.q = json.value("q").toDouble(p.q);
+    p.ro = qBound(0.0, json.value("ro").toDouble(p.ro), 1.0);
+    p.e = json.value("e").toDouble(p.e);
+    p.initialTau = json.value("initialTau").toDouble(p.initialTau);
+    p.restartBranching = qMax(0.0, json.value("restartBranching").toDouble(p.restartBranching));
+    p.restartIdle = qMax(0, json.value("restartIdle").toInt(p.restartIdle));
+    return p;
+}
+
+QJsonObject Parameters::toJson() const {
+    return QJsonObject {
+        { "algorithm", algorithm },
+        { "antCount", antCount },
+        { "alpha", alpha },
+        { "beta", beta },
+        { "q", q },
+        { "ro", ro },
+        { "e", e },
+        { "initialTau", initialTau },
+        { "restartBranching", restartBranching },
+        { "restartIdle", restartIdle },
+    };
+}
+
+void Parameters::applyTo(Algorithm *algorithm) const {
+    algorithm->aco()->setChosenAlgo(this->algorithm);
+    algorithm->aco()->setInitialTau(initialTau);
+    algorithm->setAntCount(antCount);
+    algorithm->setAlpha(alpha);
+    algorithm->setBeta(beta);
+    algorithm->setQ(q);
+    algorithm->setRo(ro);
+    algorithm->setE(e);
+    algorithm->setRestartBranching(restartBranching);
+    algorithm->setRestartIdle(restartIdle);
+}
+
+
+////////////////
+//                  WEIGHT
+//
+
+struct WeightSelect {
+    template<int Alpha, int Beta>
+    WeightFunction with() const {
+        return &Weight<Alpha, Beta>::of;
+    }
+};
+
+WeightFunction weightFunction(qreal alpha, qreal beta) {
+    return selectWeight(alpha, beta, WeightSelect());
+}
+
+
+////////////////
+//                  CONVERGENCE
+//
+
+constexpr qreal Convergence::lambda;
+
+qreal Convergence::entropyOf(int *towns, int count) {
+    if (count < 2)
+        return 0.0;
+    std::sort(towns, towns + count);
+    qreal entropy = 0.0;
+    for (int i = 0; i < count; ) {
+        int j = i;
+        while (j < count && towns[j] == towns[i])
+            j++;
+        qreal p = qreal(j - i) / count;
+        entropy -= p * log(p);
+        i = j;
+    }
+    return entropy / log(qreal(count));
+}
+
+
+////////////////
+//                  COLONY
+//
+
+Colony::Colony(const Instance *instance, const Parameters &parameters, quint32 seed, Arena *arena)
+    : m_instance(instance), m_parameters(parameters), m_seed(seed), m_mersenneTwister(seed)
+    , m_collect(selectCollect(parameters, instance->sparse())) {
+    if (!arena) {
+        m_ownArena.reserve(arenaSize(instance, parameters));
+        arena = &m_ownArena;
+    }
+    const int n = instance->size();
+    m_trails = arena->allocate<qreal>(instance->edgeCount());
+    m_scratch.append(allocateScratch(arena));
+    m_trips = arena->allocate<int>(parameters.antCount * n);
+    m_tripLengths = arena->allocate<qreal>(parameters.antCount);
+    m_successors = arena->allocate<int>(parameters.antCount * n);
+    m_followers = arena->allocate<int>(parameters.antCount);
+    m_shortestTrip = arena->allocate<int>(n);
+}
+
+size_t Colony::arenaSize(const Instance *instance, const Parameters &parameters) {
+    const int n = instance->size();
+    return Arena::sizeOf<qreal>(instance->edgeCount()) + Arena::sizeOf<int>(n) + Arena::sizeOf<qreal>(n)
+         + Arena::sizeOf<bool>(n) + Arena::sizeOf<int>(n) + Arena::sizeOf<Block>(maxBacktracks)
+         + Arena::sizeOf<int>(parameters.antCount * n) + Arena::sizeOf<qreal>(parameters.antCount)
+         + Arena::sizeOf<int>(parameters.antCount * n) + Arena::sizeOf<int>(parameters.antCount)
+         + Arena::sizeOf<int>(n);
+}
+
+const Instance *Colony::instance() const {
+    return m_instance;
+}
+
+const Parameters &Colony::parameters() const {
+    return m_parameters;
+}
+
+int Colony::c() const {
+    return m_c;
+}
+
+QVector<int> Colony::shortestTrip() const {
+    if (m_shortestTripLength == HUGE_VAL)
+        return QVector<int>();
+    QVector<int> trip(m_instance->size());
+    std::copy(m_shortestTrip, m_shortestTrip + trip.size(), trip.begin());
+    return trip;
+}
+
+qreal Colony::shortestTripLength() const {
+    return m_shortestTripLength;
+}
+
+void Colony::cycle() {
+    const int n = m_instance->size();
+    if (n < 2)
+        return;
+    touch();
+    buildTrips();
+    evaporate();
+
+    int shortestPos = -1;
+    for (int i = 0; i < m_parameters.antCount; i++) {
+        if (m_tripLengths[i] == HUGE_VAL)
+            continue;
+        deposit(m_trips + i * n, m_tripLengths[i], 1.0);
+        if (shortestPos < 0 || m_tripLengths[i] < m_tripLengths[shortestPos])
+            shortestPos = i;
+    }
+    if (shortestPos >= 0 && m_tripLengths[shortestPos] < m_shortestTripLength) {
+        std::copy(m_trips + shortestPos * n, m_trips + (shortestPos + 1) * n, m_shortestTrip);
+        m_shortestTripLength = m_tripLengths[shortestPos];
+        m_lastImprovement = m_c + 1;
+    }
+    if (m_parameters.algorithm == Aco::ElitistStrategy && m_shortestTripLength < HUGE_VAL)
+        deposit(m_shortestTrip, m_shortestTripLength, m_parameters.e);
+
+    m_c++;
+    measureEntropy();
+    m_convergence.idleCycles = m_c - m_lastImprovement;
+    m_convergence.settled = m_c - m_lastRestart >= Convergence::settleCycles;
+
+    bool branched = m_parameters.restartBranching > 0.0 && m_convergence.settled
+                    && m_convergence.branching < m_parameters.restartBranching;
+    bool idle = m_parameters.restartIdle > 0 && m_c - qMax(m_lastImprovement, m_lastRestart) >= m_parameters.restartIdle;
+    if (branched || idle)
+        restart();
+}
+
+void Colony::buildTrips() {
+    const int n = m_instance->size();
+    const int antCount = m_parameters.antCount;
+    if (m_threads == 1 && !m_deterministic) {
+        for (int i = 0; i < antCount; i++) {
+            bool built = buildTrip(m_scratch[0], m_mersenneTwister, m_trips + i * n);
+            m_tripLengths[i] = built ? tripLength(m_trips + i * n) : HUGE_VAL;
+        }
+        return;
+    }
+
+    // whichever thread takes an ant, it draws the same numbers
+    QAtomicInt next(0);
+    auto work = [this, n, antCount, &next](Scratch &scratch) {
+        for (int i = next.fetchAndAddRelaxed(1); i < antCount; i = next.fetchAndAddRelaxed(1)) {
+            scratch.generator.seed(antSeed(i));
+            bool built = buildTrip(scratch, scratch.generator, m_trips + i * n);
+            m_tripLengths[i] = built ? tripLength(m_trips + i * n) : HUGE_VAL;
+        }
+    };
+    Scratch *scratch = m_scratch.data();
+    QList<QFuture<void>> helpers;
+    for (int t = 1; t < qMin(m_threads, antCount); t++)
+        helpers.append(QtConcurrent::run(m_pool, [&work, scratch, t]() { work(scratch[t]); }));
+    work(scratch[0]);
+    for (QFuture<void> &helper : helpers)
+        helper.waitForFinished();
+}
+
+void Colony::restart() {
+    touch();
+    std::fill(m_trails, m_trails + m_instance->edgeCount(), m_parameters.initialTau);
+    if (m_shortestTripLength < HUGE_VAL)
+        deposit(m_shortestTrip, m_shortestTripLength, m_parameters.e);
+    m_lastRestart = m_c;
+    Convergence convergence;
+    convergence.restarts = m_convergence.restarts + 1;
+    m_convergence = convergence;
+}
+
+void Colony::migrate(const QVector<int> &trip, qreal length) {
+    if (trip.size() != m_instance->size() || length >= m_shortestTripLength)
+        return;
+    touch();
+    std::copy(trip.begin(), trip.end(), m_shortestTrip);
+    m_shortestTripLength = length;
+    // the immigrant is reinforced like the best trip of the elitist strategy
+    deposit(trip.constData(), length, m_parameters.e);
+}
+
+const Convergence &Colony::convergence() const {
+    return m_convergence;
+}
+
+int Colony::threads() const {
+    return m_threads;
+}
+
+bool Colony::deterministic() const {
+    return m_deterministic;
+}
+
+void Colony::setThreads(int threads, QThreadPool *pool) {
+    m_threads = qMax(1, threads);
+    m_pool = pool ? pool : QThreadPool::globalInstance();
+    // the colony's own arena may already be in use, these end up in blocks of their own
+    while (m_scratch.size() < m_threads)
+        m_scratch.append(allocateScratch(&m_ownArena));
+}
+
+void Colony::setDeterministic(bool deterministic) {
+    m_deterministic = deterministic;
+}
+
+qreal Colony::trail(int from, int to) const {
+    int e = m_instance->edge(from, to);
+    return e < 0 ? 0.0 : edgeTrail(e);
+}
+
+qreal Colony::edgeTrail(int edge) const {
+    return m_touched ? m_trails[edge] : m_parameters.initialTau;
+}
+
+void Colony::copyTrails(qreal *trails) const {
+    if (m_touched)
+        std::copy(m_trails, m_trails + m_instance->edgeCount(), trails);
+    else
+        std::fill(trails, trails + m_instance->edgeCount(), m_parameters.initialTau);
+}
+
+void Colony::setTrail(int from, int to, qreal trail) {
+    touch();
+    int e = m_instance->edge(from, to);
+    if (e >= 0)
+        m_trails[e] = qMax(m_parameters.initialTau, trail);
+}
+
+void Colony::touch() {
+    if (m_touched)
+        return;
+    m_touched = true;
+    std::fill(m_trails, m_trails + m_instance->edgeCount(), m_parameters.initialTau);
+}
+
+Colony::Scratch Colony::allocateScratch(Arena *arena) {
+    const int n = m_instance->size();
+    Scratch scratch;
+    scratch.candidates = arena->allocate<int>(n);
+    scratch.weights = arena->allocate<qreal>(n);
+    scratch.visited = arena->allocate<bool>(n);
+    scratch.blocked = arena->allocate<int>(n);
+    // every entry is a backtrack
+    scratch.blockedStack = arena->allocate<Block>(maxBacktracks);
+    return scratch;
+}
+
+quint32 Colony::antSeed(int ant) const {
+    // splitmix64 over the seed, the cycle and the ant
+    quint64 z = (quint64(m_seed) << 32 | quint32(m_c)) * 0x9e3779b97f4a7c15ULL + quint64(ant) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return quint32(z ^ (z >> 31));
+}
+
+template<int Alpha, int Beta, bool Sparse>
+qreal Colony::collectCandidates(Scratch &scratch, int current, int position) {
+    const int n = m_instance->size();
+    const qreal alpha = m_parameters.alpha;
+    const qreal beta = m_parameters.beta;
+    const int *towns = m_instance->edgeTowns();
+    const qreal *distances = m_instance->edgeDistances();
+    scratch.candidateCount = 0;
+    qreal totalWeight = 0.0;
+    auto consider = [&](int e, int t) {
+        qreal distance = distances[e];
+        if (scratch.visited[t] || scratch.blocked[t] == position || distance == HUGE_VAL)
+            return;
+        qreal weight = Weight<Alpha, Beta>::of(m_trails[e], distance, alpha, beta);
+        scratch.candidates[scratch.candidateCount] = t;
+        scratch.weights[scratch.candidateCount++] = weight;
+        totalWeight += weight;
+    };
+
+    // a dense row is addressed by the town directly, a sparse one has to be searched
+    const int *neighbours = m_instance->neighbours(current);
+    const int neighbourCount = m_instance->neighbourCount();
+    for (int i = 0; i < neighbourCount && neighbours[i] >= 0; i++) {
+        int t = neighbours[i];
+        int e = Sparse ? m_instance->edge(current, t) : current * n + t;
+        if (e >= 0)
+            consider(e, t);
+    }
+    if (scratch.candidateCount > 0)
+        return totalWeight;
+
+    const int begin = Sparse ? m_instance->edgesBegin(current) : current * n;
+    const int end = Sparse ? m_instance->edgesEnd(current) : begin + n;
+    for (int e = begin; e < end; e++)
+        consider(e, Sparse ? towns[e] : e - begin);
+    return totalWeight;
+}
+
+template<int Alpha, int Beta>
+Colony::Collect Colony::collectFor(bool sparse) {
+    if (sparse)
+        return &Colony::collectCandidates<Alpha, Beta, true>;
+    return &Colony::collectCandidates<Alpha, Beta, false>;
+}
+
+struct Colony::CollectSelect {
+    bool sparse;
+
+    template<int Alpha, int Beta>
+    Collect with() const {
+        return collectFor<Alpha, Beta>(sparse);
+    }
+};
+
+Colony::Collect Colony::selectCollect(const Parameters &parameters, bool sparse) {
+    return selectWeight(parameters.alpha, parameters.beta, CollectSelect { sparse });
+}
+
+bool Colony::buildTrip(Scratch &scratch, std::mt19937 &generator, int *trip) {
+    const int n = m_instance->size();
+    std::uniform_real_distribution<qreal> random(0.0, 1.0);
+    std::fill(scratch.visited, scratch.visited + n, false);
+    std::fill(scratch.blocked, scratch.blocked + n, -1);
+    scratch.blockedCount = 0;
+
+    trip[0] = qMin(int(random(generator) * n), n - 1);
+    scratch.visited[trip[0]] = true;
+    int position = 1;
+    int backtracks = 0;
+    while (true) {
+        if (position == n) {
+            if (m_instance->connected(trip[n - 1], trip[0]))
+                return true;
+        }
+        else {
+            qreal totalWeight = (this->*m_collect)(scratch, trip[position - 1], position);
+            if (scratch.candidateCount > 0) {
+                int next = scratch.candidates[scratch.candidateCount - 1];
+                if (totalWeight > 0.0) {
+                    qreal target = random(generator) * totalWeight;
+                    qreal sum = 0.0;
+                    for (int i = 0; i < scratch.candidateCount; i++) {
+                        sum += scratch.weights[i];
+                        if (sum >= target) {
+                            next = scratch.candidates[i];
+                            break;
+                        }
+                    }
+                }
+                else {
+                    next = scratch.candidates[qMin(int(random(generator) * scratch.candidateCount), scratch.candidateCount - 1)];
+                }
+                trip[position++] = next;
+                scratch.visited[next] = true;
+                continue;
+            }
+        }
+
+        // dead end, go back and forbid the last town at its position
+        if (position == 1 || ++backtracks > maxBacktracks)
+            return false;
+        position--;
+        while (scratch.blockedCount > 0 && scratch.blockedStack[scratch.blockedCount - 1].position > position) {
+            scratch.blockedCount--;
+            scratch.blocked[scratch.blockedStack[scratch.blockedCount].town] = scratch.blockedStack[scratch.blockedCount].previous;
+        }
+        int town = trip[position];
+        scratch.visited[town] = false;
+        scratch.blockedStack[scratch.blockedCount++] = { position, town, scratch.blocked[town] };
+        scratch.blocked[town] = position;
+    }
+}
+
+qreal Colony::tripLength(const int *trip) const {
+    const int n = m_instance->size();
+    qreal ret = 0.0;
+    for (int i = 0; i < n; i++)
+        ret += m_instance->distance(trip[i], trip[(i + 1) % n]);
+    return ret;
+}
+
+// the branching factor is counted on the trails the ants of this cycle followed
+void Colony::evaporate() {
+    const int n = m_instance->size();
+    const qreal factor = 1 - m_parameters.ro;
+    int branches = 0;
+    for (int town = 0; town < n; town++) {
+        const int begin = m_instance->edgesBegin(town);
+        const int end = m_instance->edgesEnd(town);
+        qreal min = HUGE_VAL;
+        qreal max = 0.0;
+        for (int e = begin; e < end; e++) {
+            if (m_instance->edgeDistance(e) == HUGE_VAL)
+                continue;
+            min = qMin(min, m_trails[e]);
+            max = qMax(max, m_trails[e]);
+        }
+        const qreal threshold = min + Convergence::lambda * (max - min);
+        for (int e = begin; e < end; e++) {
+            if (m_trails[e] >= threshold && m_instance->edgeDistance(e) != HUGE_VAL)
+                branches++;
+            m_trails[e] = qMax(m_parameters.initialTau, factor * m_trails[e]);
+        }
+    }
+    // a symmetric instance has every edge in both directions, the town before and after it are both strong
+    m_convergence.branching = qreal(branches) / ((m_instance->symmetric() ? 2 : 1) * n);
+}
+
+void Colony::measureEntropy() {
+    const int n = m_instance->size();
+    int valid = 0;
+    for (int i = 0; i < m_parameters.antCount; i++) {
+        if (m_tripLengths[i] == HUGE_VAL)
+            continue;
+        const int *trip = m_trips + i * n;
+        int *successors = m_successors + valid * n;
+        for (int j = 0; j < n; j++)
+            successors[trip[j]] = trip[(j + 1) % n];
+        valid++;
+    }
+    if (valid == 0)
+        return;
+
+    qreal entropy = 0.0;
+    for (int town = 0; town < n; town++) {
+        for (int i = 0; i < valid; i++)
+            m_followers[i] = m_successors[i * n + town];
+        entropy += Convergence::entropyOf(m_followers, valid);
+    }
+    m_convergence.entropy = entropy / n;
+}
+
+void Colony::deposit(const int *trip, qreal length, qreal weight) {
+    const int n = m_instance->size();
+    for (int i = 0; i < n; i++) {
+        int a = trip[i];
+        int b = trip[(i + 1) % n];
+        int forward = m_instance->edge(a, b);
+        int backward = m_instance->edge(b, a);
+        if (forward < 0)
+            continue;
+        qreal amount = m_parameters.q;
+        if (m_parameters.algorithm == Aco::AntCycle || m_parameters.algorithm == Aco::ElitistStrategy)
+            amount /= length;
+        else if (m_parameters.algorithm == Aco::AntQuantity)
+            amount /= m_instance->edgeDistance(forward);
+        m_trails[forward] += weight * amount;
+        if (backward >= 0 && m_instance->symmetric())
+            m_trails[backward] += weight * amount;
+    }
+}
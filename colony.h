@@ -0,0 +1,368 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef COLONY_H
+#define COLONY_H
+
+#include <QJsonObject>
+#include <QVector>
+
+#include <cmath>
+#include <random>
+
+#include "arena.h"
+
+class QThreadPool;
+
+class Canvas;
+class Algorithm;
+
+/**
+ * Snapshot of a Canvas that can be solved without touching any QObjects.
+ * Towns are referred to by their index in Canvas::towns(), missing paths
+ * have an infinite distance.
+ *
+ * Dense instances keep a full distance matrix. Sparse ones (road networks,
+ * hand drawn maps) keep only the existing paths in compressed sparse rows,
+ * the paths leaving a town are sorted by the town they lead to. Either way
+ * every path has an edge index in the range [0, edgeCount()) that the
+ * colonies use to address their trails.
+ *
+ * Paths are one-way, in a symmetric instance there is a path back with the
+ * same distance and the colonies keep both of their trails equal. The rows
+ * hold the paths leaving a town so the ants only ever scan a single row.
+ *
+ * A dense instance can also look at a matrix it doesn't own, see
+ * fromMatrix(). It is copied the first time the instance changes it.
+ *
+ * Every town can also have a short list of its nearest neighbours, ants
+ * look at those first and scan the whole row only when all of them have
+ * been visited already.
+ */
+class Instance {
+public:
+    struct Edge {
+        int from;
+        int to;
+        qreal distance;
+    };
+
+    static const int defaultNeighbourCount = 16;
+
+    Instance(int size = 0);
+    static Instance fromEdges(int size, const QVector<Edge> &edges, bool sparse);
+    static Instance fromMatrix(int size, const qreal *distances, bool symmetric);
+    static Instance fromCanvas(Canvas *canvas);
+
+    int size() const;
+    bool sparse() const;
+    bool symmetric() const;
+    void setSymmetric(bool symmetric);
+    qreal distance(int from, int to) const;
+    bool connected(int from, int to) const;
+    void setDistance(int from, int to, qreal distance);
+    qreal *row(int town);
+    const qreal *matrix() const;
+
+    int edgeCount() const;
+    int edge(int from, int to) const;
+    int edgesBegin(int town) const;
+    int edgesEnd(int town) const;
+    int edgeTown(int edge) const;
+    qreal edgeDistance(int edge) const;
+    // indexed by edge, the towns are only there in a sparse instance
+    const int *edgeTowns() const;
+    const qreal *edgeDistances() const;
+
+    int neighbourCount() const;
+    const int *neighbours(int town) const;
+    void setNeighbours(int count, const QVector<int> &neighbours);
+    void buildNeighbours(int count);
+private:
+    void detach();
+
+    int m_size { 0 };
+    bool m_sparse { false };
+    bool m_symmetric { true };
+    // dense
+    QVector<qreal> m_distances { };
+    const qreal *m_matrix { nullptr };
+    // sparse
+    QVector<int> m_offsets { };
+    QVector<int> m_towns { };
+    QVector<qreal> m_edgeDistances { };
+    // neighbourCount entries per town, padded with -1
+    int m_neighbourCount { 0 };
+    QVector<int> m_neighbours { };
+};
+
+/**
+ * Settings of a single colony, mirrors the properties of Algorithm. As
+ * JSON they are an object with the same keys, missing ones keep their
+ * value, which is also the format of the presets.
+ */
+struct Parameters {
+    int algorithm { 0 };
+    int antCount { 5 };
+    qreal alpha { 1.0 };
+    qreal beta { 2.0 };
+    qreal q { 20.0 };
+    qreal ro { 0.1 };
+    qreal e { 2 };
+    qreal initialTau { 1 };
+    // the trails are reset when the branching factor drops below restartBranching
+    // or after restartIdle cycles without a shorter trip, zero turns either off
+    qreal restartBranching { 0.0 };
+    int restartIdle { 0 };
+
+    static Parameters fromAlgorithm(Algorithm *algorithm);
+    static Parameters fromJson(const QJsonObject &json);
+    static Parameters fromJson(const QJsonObject &json, const Parameters &defaults);
+    QJsonObject toJson() const;
+    void applyTo(Algorithm *algorithm) const;
+};
+
+/**
+ * x to the power of N with plain multiplications.
+ */
+template<int N>
+inline qreal ipow(qreal x) {
+    qreal half = ipow<N / 2>(x);
+    return N % 2 ? half * half * x : half * half;
+}
+
+template<>
+inline qreal ipow<0>(qreal) {
+    return 1.0;
+}
+
+template<>
+inline qreal ipow<1>(qreal x) {
+    return x;
+}
+
+/**
+ * How much an ant wants to take a path, trail^alpha * (1 / distance)^beta.
+ * Almost every run uses alpha = 1 and a small integer beta, those are
+ * template arguments and the weight takes a few multiplications. Weight<-1, -1>
+ * takes any exponents at run time.
+ */
+template<int Alpha, int Beta>
+struct Weight {
+    static inline qreal of(qreal trail, qreal distance, qreal, qreal) {
+        return ipow<Alpha>(trail) / ipow<Beta>(distance);
+    }
+};
+
+template<>
+struct Weight<-1, -1> {
+    static inline qreal of(qreal trail, qreal distance, qreal alpha, qreal beta) {
+        return pow(trail, alpha) * pow(1.0 / distance, beta);
+    }
+};
+
+/**
+ * The one place that knows which exponents Weight is specialised for,
+ * returns select.with<Alpha, Beta>() for them and select.with<-1, -1>()
+ * for any others.
+ */
+template<typename Select>
+auto selectWeight(qreal alpha, qreal beta, const Select &select) -> decltype(select.template with<-1, -1>()) {
+    if (alpha == 1.0) {
+        if (beta == 1.0)
+            return select.template with<1, 1>();
+        if (beta == 2.0)
+            return select.template with<1, 2>();
+        if (beta == 3.0)
+            return select.template with<1, 3>();
+        if (beta == 4.0)
+            return select.template with<1, 4>();
+        if (beta == 5.0)
+            return select.template with<1, 5>();
+    }
+    return select.template with<-1, -1>();
+}
+
+typedef qreal (*WeightFunction)(qreal trail, qreal distance, qreal alpha, qreal beta);
+WeightFunction weightFunction(qreal alpha, qreal beta);
+
+/**
+ * How far a colony has converged. The branching factor is the mean number
+ * of paths leaving a town whose trail is above min + lambda * (max - min)
+ * of the trails leaving it, halved on symmetric instances where a path
+ * leaves both of its towns, so it approaches 1 as the ants settle on a
+ * single trip. The entropy of the towns following each town in the trips
+ * of the last cycle is normalized to [0, 1] and averaged, it drops to 0
+ * once all the ants take the same trip.
+ *
+ * Right after the trails are reset only the trip deposited again stands
+ * out and the branching factor is exactly 1, it is settled and can stop
+ * or restart a colony only settleCycles cycles later.
+ */
+struct Convergence {
+    static constexpr qreal lambda = 0.05;
+    static const int settleCycles = 10;
+
+    qreal branching { 0.0 };
+    qreal entropy { 1.0 };
+    int idleCycles { 0 };
+    int restarts { 0 };
+    bool settled { false };
+
+    // sorts the towns in place
+    static qreal entropyOf(int *towns, int count);
+};
+
+/**
+ * One colony with its own pheromone matrix. A cycle lets every ant build
+ * a full trip and then updates the trails the same way Algorithm does.
+ * Colonies don't share any state so several of them can run in parallel.
+ *
+ * An ant that runs into a dead end goes back and tries another town, after
+ * maxBacktracks of those its trip is rejected.
+ *
+ * The ants choose their next town in a kernel specialised for the exponents
+ * of the parameters (see Weight) and for the dense or sparse instance, it is
+ * picked once when the colony is created.
+ *
+ * Convergence is measured on the way, the trails are updated anyway and
+ * the branching factor is counted in the same pass. When the colony
+ * stagnates as set in its Parameters, all trails go back to initialTau and
+ * only the shortest trip so far is deposited again.
+ *
+ * The trails, the scratch space and trips of the ants and the shortest
+ * trip come from an arena, the colony's own one unless it's given one
+ * with at least arenaSize() bytes left. The distances and candidate lists
+ * stay in the Instance, which several colonies may share. The trails are
+ * only written once the colony is used, so they end up close to the
+ * thread that runs the cycles.
+ *
+ * The ants can build their trips in several threads, each with scratch
+ * space of its own taken from the colony's own arena. Every ant then draws
+ * from a generator seeded by the seed of the colony, the cycle and the ant,
+ * and the trips are deposited in the order of the ants once all of them
+ * are built. So the trips, the sums of the trails and with them the whole
+ * run don't depend on the number of threads or on which thread built which
+ * trip. A deterministic colony does the same in a single thread, otherwise
+ * a single thread draws all the ants from one generator.
+ */
+class Colony {
+public:
+    static const int maxBacktracks = 1000;
+
+    Colony(const Instance *instance, const Parameters &parameters, quint32 seed, Arena *arena = nullptr);
+    static size_t arenaSize(const Instance *instance, const Parameters &parameters);
+
+    const Instance *instance() const;
+    const Parameters &parameters() const;
+    int c() const;
+    // a copy, empty until the first trip was found
+    QVector<int> shortestTrip() const;
+    qreal shortestTripLength() const;
+    const Convergence &convergence() const;
+    int threads() const;
+    bool deterministic() const;
+    void setThreads(int threads, QThreadPool *pool = nullptr);
+    void setDeterministic(bool deterministic);
+    qreal trail(int from, int to) const;
+    qreal edgeTrail(int edge) const;
+    // the trails of all edgeCount() edges of the instance
+    void copyTrails(qreal *trails) const;
+    void setTrail(int from, int to, qreal trail);
+
+    void cycle();
+    void migrate(const QVector<int> &trip, qreal length);
+    void restart();
+private:
+    Q_DISABLE_COPY(Colony)
+
+    // town was forbidden at position, before that it was forbidden at previous
+    struct Block {
+        int position;
+        int town;
+        int previous;
+    };
+
+    // what a single ant needs while building its trip
+    struct Scratch {
+        int *candidates { nullptr };
+        qreal *weights { nullptr };
+        int candidateCount { 0 };
+        bool *visited { nullptr };
+        int *blocked { nullptr };
+        Block *blockedStack { nullptr };
+        int blockedCount { 0 };
+        std::mt19937 generator { };
+    };
+
+    typedef qreal (Colony::*Collect)(Scratch &scratch, int current, int position);
+    struct CollectSelect;
+    static Collect selectCollect(const Parameters &parameters, bool sparse);
+    template<int Alpha, int Beta>
+    static Collect collectFor(bool sparse);
+
+    void touch();
+    Scratch allocateScratch(Arena *arena);
+    quint32 antSeed(int ant) const;
+    void buildTrips();
+    template<int Alpha, int Beta, bool Sparse>
+    qreal collectCandidates(Scratch &scratch, int current, int position);
+    bool buildTrip(Scratch &scratch, std::mt19937 &generator, int *trip);
+    qreal tripLength(const int *trip) const;
+    void evaporate();
+    void measureEntropy();
+    void deposit(const int *trip, qreal length, qreal weight);
+
+    const Instance *m_instance { nullptr };
+    Parameters m_parameters { };
+    quint32 m_seed { 0 };
+    std::mt19937 m_mersenneTwister { };
+    int m_threads { 1 };
+    QThreadPool *m_pool { nullptr };
+    bool m_deterministic { false };
+
+    Collect m_collect { nullptr };
+    Arena m_ownArena { };
+    bool m_touched { false };
+    qreal *m_trails { nullptr };
+    // one for every thread, the first one comes from the arena the colony was given
+    QVector<Scratch> m_scratch { };
+    // antCount trips of size() towns one after another
+    int *m_trips { nullptr };
+    qreal *m_tripLengths { nullptr };
+    // the town following every town in every trip and the ones following a single town
+    int *m_successors { nullptr };
+    int *m_followers { nullptr };
+
+    // size() towns, valid once the length is finite
+    int *m_shortestTrip { nullptr };
+    qreal m_shortestTripLength { HUGE_VAL };
+    int m_c { 0 };
+    int m_lastImprovement { 0 };
+    int m_lastRestart { 0 };
+    Convergence m_convergence { };
+};
+
+#endif // COLONY_H
@@ -0,0 +1,357 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "decomposition.h"
+#include "batch.h"
+#include "solver.h"
+#include "spatialgrid.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+
+Decomposition::Decomposition(const QVector<qreal> &x, const QVector<qreal> &y, const Distance &distance,
+                             const Parameters &parameters, quint32 seed)
+    : m_x(x), m_y(y), m_distance(distance), m_parameters(parameters), m_seed(seed) {
+}
+
+int Decomposition::size() const {
+    return m_x.size();
+}
+
+qreal Decomposition::distance(int a, int b) const {
+    return m_distance(a, b);
+}
+
+qreal Decomposition::tripLength(const QVector<int> &trip) const {
+    qreal length = 0.0;
+    for (int i = 0; i < trip.size(); i++)
+        length += distance(trip[i], trip[(i + 1) % trip.size()]);
+    return length;
+}
+
+Instance Decomposition::instance() const {
+    const int n = size();
+    Instance instance(n);
+    for (int a = 0; a < n; a++) {
+        qreal *row = instance.row(a);
+        for (int b = 0; b < n; b++) {
+            if (a != b)
+                row[b] = distance(a, b);
+        }
+    }
+    instance.buildNeighbours(Instance::defaultNeighbourCount);
+    return instance;
+}
+
+int Decomposition::clusterSize() const {
+    return m_clusterSize;
+}
+
+void Decomposition::setClusterSize(int size) {
+    m_clusterSize = qMax(4, size);
+}
+
+void Decomposition::setTimeout(qint64 timeout) {
+    m_timeout = timeout;
+}
+
+void Decomposition::setStagnationLimit(int cycles) {
+    m_stagnationLimit = qMax(0, cycles);
+}
+
+void Decomposition::setMaxCycles(int cycles) {
+    m_maxCycles = qMax(0, cycles);
+}
+
+Decomposition::Result Decomposition::solve(int threads, QThreadPool *pool) {
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+    const int n = size();
+    if (n == 0)
+        return result;
+
+    QVector<qreal> centreX, centreY;
+    QVector<QVector<int>> clusters = partition(centreX, centreY);
+    QVector<int> order = orderClusters(centreX, centreY);
+    result.clusters = clusters.size();
+    result.partitioning = timer.elapsed();
+
+    // clusters of up to three towns have only one trip
+    Batch batch(m_parameters, m_seed);
+    batch.setTimeout(m_timeout);
+    batch.setStagnationLimit(m_stagnationLimit);
+    batch.setMaxCycles(m_maxCycles);
+    QVector<int> solvedAs(clusters.size(), -1);
+    for (int c = 0; c < clusters.size(); c++) {
+        const QVector<int> &members = clusters[c];
+        if (members.size() <= 3)
+            continue;
+        Instance instance(members.size());
+        for (int a = 0; a < members.size(); a++) {
+            qreal *row = instance.row(a);
+            for (int b = 0; b < members.size(); b++) {
+                if (a != b)
+                    row[b] = distance(members[a], members[b]);
+            }
+        }
+        solvedAs[c] = batch.add(instance);
+    }
+    QVector<Solver::Result> solved = batch.solve(threads, pool);
+    result.solving = timer.elapsed() - result.partitioning;
+
+    // every trip is entered next to where the previous one ended and left
+    // on the side closer to the next cluster
+    QVector<int> trip;
+    QVector<int> seams;
+    trip.reserve(n);
+    for (int i = 0; i < order.size(); i++) {
+        const QVector<int> &members = clusters[order[i]];
+        const int m = members.size();
+        QVector<int> local = solvedAs[order[i]] >= 0 ? solved[solvedAs[order[i]]].trip : QVector<int>();
+        if (local.size() != m) {
+            local.resize(m);
+            for (int j = 0; j < m; j++)
+                local[j] = j;
+        }
+
+        int entry = 0;
+        if (!trip.isEmpty()) {
+            for (int j = 1; j < m; j++) {
+                if (distance(trip.last(), members[local[j]]) < distance(trip.last(), members[local[entry]]))
+                    entry = j;
+            }
+        }
+        int next = order[(i + 1) % order.size()];
+        auto towardsNext = [&](int town) {
+            qreal dx = m_x[town] - centreX[next];
+            qreal dy = m_y[town] - centreY[next];
+            return dx * dx + dy * dy;
+        };
+        bool forward = towardsNext(members[local[(entry + m - 1) % m]]) <= towardsNext(members[local[(entry + 1) % m]]);
+
+        if (!trip.isEmpty())
+            seams.append(trip.last());
+        seams.append(members[local[entry]]);
+        for (int j = 0; j < m; j++)
+            trip.append(members[local[forward ? (entry + j) % m : (entry - j + m) % m]]);
+    }
+    seams.append(trip.last());
+
+    result.moves = repair(trip, seams);
+    result.trip = trip;
+    result.length = tripLength(trip);
+    result.elapsed = timer.elapsed();
+    result.repairing = result.elapsed - result.partitioning - result.solving;
+    return result;
+}
+
+QVector<QVector<int>> Decomposition::partition(QVector<qreal> &centreX, QVector<qreal> &centreY) {
+    const int n = size();
+    const int k = qMax(1, (n + m_clusterSize - 1) / m_clusterSize);
+    std::mt19937 random(m_seed);
+
+    // the centres start at distinct random towns
+    QVector<int> towns(n);
+    for (int i = 0; i < n; i++)
+        towns[i] = i;
+    centreX.resize(k);
+    centreY.resize(k);
+    for (int c = 0; c < k; c++) {
+        std::swap(towns[c], towns[c + random() % (n - c)]);
+        centreX[c] = m_x[towns[c]];
+        centreY[c] = m_y[towns[c]];
+    }
+
+    // the centres are in a grid so every town only looks at the ones around it
+    const qreal cell = SpatialGrid<int>::cellSizeFor(m_x, m_y, k);
+    QVector<int> assignment(n, -1);
+    for (int iteration = 0; iteration < kMeansIterations; iteration++) {
+        SpatialGrid<int> grid(cell);
+        for (int c = 0; c < k; c++)
+            grid.insert(c, centreX[c], centreY[c]);
+        bool changed = false;
+        for (int i = 0; i < n; i++) {
+            int c = grid.nearest(m_x[i], m_y[i], 1, [](int) { return false; }).value(0);
+            if (assignment[i] != c) {
+                assignment[i] = c;
+                changed = true;
+            }
+        }
+        if (!changed)
+            break;
+
+        // a centre that lost all its towns stays where it is
+        QVector<qreal> sumX(k, 0.0), sumY(k, 0.0);
+        QVector<int> counts(k, 0);
+        for (int i = 0; i < n; i++) {
+            sumX[assignment[i]] += m_x[i];
+            sumY[assignment[i]] += m_y[i];
+            counts[assignment[i]]++;
+        }
+        for (int c = 0; c < k; c++) {
+            if (counts[c] > 0) {
+                centreX[c] = sumX[c] / counts[c];
+                centreY[c] = sumY[c] / counts[c];
+            }
+        }
+    }
+
+    QVector<QVector<int>> clusters(k);
+    for (int i = 0; i < n; i++)
+        clusters[assignment[i]].append(i);
+    for (int c = k - 1; c >= 0; c--) {
+        if (clusters[c].isEmpty()) {
+            clusters.remove(c);
+            centreX.remove(c);
+            centreY.remove(c);
+        }
+    }
+    return clusters;
+}
+
+QVector<int> Decomposition::orderClusters(const QVector<qreal> &centreX, const QVector<qreal> &centreY) {
+    const int k = centreX.size();
+    QVector<int> order(k);
+    for (int c = 0; c < k; c++)
+        order[c] = c;
+    if (k <= 3)
+        return order;
+
+    Instance instance(k);
+    for (int a = 0; a < k; a++) {
+        qreal *row = instance.row(a);
+        for (int b = 0; b < k; b++) {
+            if (a != b)
+                row[b] = sqrt((centreX[a] - centreX[b]) * (centreX[a] - centreX[b]) + (centreY[a] - centreY[b]) * (centreY[a] - centreY[b]));
+        }
+    }
+    instance.buildNeighbours(Instance::defaultNeighbourCount);
+    Solver solver(m_parameters, m_seed);
+    solver.setMaxCycles(m_maxCycles);
+    solver.setStagnationLimit(qMax(1, m_maxCycles / 4));
+    Solver::Result result = solver.solve(instance, m_timeout);
+    return result.trip.size() == k ? result.trip : order;
+}
+
+int Decomposition::repair(QVector<int> &trip, const QVector<int> &seams) {
+    const int n = trip.size();
+    if (n < 5)
+        return 0;
+
+    // the neighbours are only looked up for the towns the search gets to
+    SpatialGrid<int> grid(SpatialGrid<int>::cellSizeFor(m_x, m_y, qMax(1, n / 2)));
+    for (int i = 0; i < n; i++)
+        grid.insert(i, m_x[i], m_y[i]);
+    QVector<QVector<int>> neighbours(n);
+    auto neighboursOf = [&](int town) -> const QVector<int> & {
+        if (neighbours[town].isEmpty()) {
+            neighbours[town] = grid.nearest(m_x[town], m_y[town], neighbourCount, [town](int other) {
+                return other == town;
+            });
+        }
+        return neighbours[town];
+    };
+
+    QVector<int> position(n);
+    for (int i = 0; i < n; i++)
+        position[trip[i]] = i;
+    auto next = [&](int town) {
+        return trip[(position[town] + 1) % n];
+    };
+    auto previous = [&](int town) {
+        return trip[(position[town] + n - 1) % n];
+    };
+    // reverses the trip from position i forward to position j, or the rest
+    // of it when that is shorter, which leaves the same trip
+    auto reverse = [&](int i, int j) {
+        int length = (j - i + n) % n + 1;
+        if (2 * length > n) {
+            int first = (j + 1) % n;
+            j = (i + n - 1) % n;
+            i = first;
+            length = n - length;
+        }
+        for (int s = 0; s < length / 2; s++) {
+            int a = (i + s) % n;
+            int b = (j - s + n) % n;
+            std::swap(trip[a], trip[b]);
+            position[trip[a]] = a;
+            position[trip[b]] = b;
+        }
+    };
+
+    std::deque<int> queue;
+    QVector<bool> queued(n, false);
+    auto push = [&](int town) {
+        if (!queued[town]) {
+            queued[town] = true;
+            queue.push_back(town);
+        }
+    };
+    for (int town : seams)
+        push(town);
+
+    int moves = 0;
+    while (!queue.empty()) {
+        int a = queue.front();
+        queue.pop_front();
+        queued[a] = false;
+        // a-b and c-d become a-c and b-d, b and d follow (or precede) a and c
+        for (int direction = 0; direction < 2; direction++) {
+            int b = direction == 0 ? next(a) : previous(a);
+            qreal ab = distance(a, b);
+            bool improved = false;
+            for (int c : neighboursOf(a)) {
+                qreal ac = distance(a, c);
+                if (c == b || ac >= ab)
+                    continue;
+                int d = direction == 0 ? next(c) : previous(c);
+                if (d == a)
+                    continue;
+                if (ab + distance(c, d) - ac - distance(b, d) > 1e-9) {
+                    if (direction == 0)
+                        reverse(position[b], position[c]);
+                    else
+                        reverse(position[a], position[d]);
+                    push(a);
+                    push(b);
+                    push(c);
+                    push(d);
+                    moves++;
+                    improved = true;
+                    break;
+                }
+            }
+            if (improved)
+                break;
+        }
+    }
+    return moves;
+}
@@ -0,0 +1,103 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef DECOMPOSITION_H
+#define DECOMPOSITION_H
+
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+#include "colony.h"
+
+/**
+ * Cluster first, route second solver for instances too big for a single
+ * colony. The towns are split into clusters of about clusterSize towns by
+ * k-means, every cluster is solved as a small instance of its own by a
+ * Batch and the trips of the clusters are joined in the order a colony
+ * finds for their centres. 2-opt over the nearest neighbours of the towns
+ * then repairs the seams, starting from the towns where two trips meet.
+ *
+ * Only the coordinates of the towns are kept, the distances come from a
+ * function so no matrix of the whole instance is ever built. The distance
+ * has to be symmetric.
+ */
+class Decomposition {
+public:
+    typedef std::function<qreal(int a, int b)> Distance;
+
+    static const int defaultClusterSize = 300;
+    static const int kMeansIterations = 10;
+    static const int neighbourCount = 8;
+
+    struct Result {
+        QVector<int> trip { };
+        qreal length { HUGE_VAL };
+        int clusters { 0 };
+        // improving 2-opt moves made while repairing
+        int moves { 0 };
+        // milliseconds spent in the stages and in total
+        qint64 partitioning { 0 };
+        qint64 solving { 0 };
+        qint64 repairing { 0 };
+        qint64 elapsed { 0 };
+    };
+
+    Decomposition(const QVector<qreal> &x, const QVector<qreal> &y, const Distance &distance,
+                  const Parameters &parameters = Parameters(), quint32 seed = 0);
+
+    int size() const;
+    qreal distance(int a, int b) const;
+    qreal tripLength(const QVector<int> &trip) const;
+    // a dense instance of all the towns, only for comparing with a single colony on small ones
+    Instance instance() const;
+
+    int clusterSize() const;
+    void setClusterSize(int size);
+    // limits of every cluster, as in Batch
+    void setTimeout(qint64 timeout);
+    void setStagnationLimit(int cycles);
+    void setMaxCycles(int cycles);
+
+    Result solve(int threads = 0, QThreadPool *pool = QThreadPool::globalInstance());
+private:
+    QVector<QVector<int>> partition(QVector<qreal> &centreX, QVector<qreal> &centreY);
+    QVector<int> orderClusters(const QVector<qreal> &centreX, const QVector<qreal> &centreY);
+    int repair(QVector<int> &trip, const QVector<int> &seams);
+
+    QVector<qreal> m_x { };
+    QVector<qreal> m_y { };
+    Distance m_distance { };
+    Parameters m_parameters { };
+    quint32 m_seed { 0 };
+    int m_clusterSize { defaultClusterSize };
+    qint64 m_timeout { -1 };
+    int m_stagnationLimit { 0 };
+    int m_maxCycles { 100 };
+};
+
+#endif // DECOMPOSITION_H
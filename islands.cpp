@@ -0,0 +1,237 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "islands.h"
+#include "aco.h"
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <limits>
+
+IslandModel::IslandModel(Aco *parent)
+    : QObject(parent), m_colonyCount(qMax(1, QThread::idealThreadCount())) {
+    connect(parent, &Canvas::topologyChanged, this, &IslandModel::reset);
+    connect(parent, &Canvas::distancesChanged, this, &IslandModel::reset);
+    connect(&m_epoch, &QFutureWatcher<void>::finished, this, &IslandModel::epochFinished);
+}
+
+IslandModel::~IslandModel() {
+    m_epoch.waitForFinished();
+    qDeleteAll(m_colonies);
+    delete m_metricClosure;
+}
+
+Aco *IslandModel::aco() {
+    return qobject_cast<Aco*>(parent());
+}
+
+int IslandModel::colonyCount() {
+    return m_colonyCount;
+}
+
+int IslandModel::migrationInterval() {
+    return m_migrationInterval;
+}
+
+int IslandModel::migrationTopology() {
+    return m_migrationTopology;
+}
+
+bool IslandModel::heterogeneous() {
+    return m_heterogeneous;
+}
+
+bool IslandModel::closure() {
+    return m_closure;
+}
+
+int IslandModel::c() {
+    return m_c;
+}
+
+qreal IslandModel::shortestTripLength() {
+    return m_shortestTripLength;
+}
+
+Parameters IslandModel::parametersFor(int colony, const Parameters &base) {
+    Parameters p = base;
+    if (!m_heterogeneous || m_colonyCount < 2)
+        return p;
+    // spread the colonies between greedy (high beta, fast evaporation)
+    // and explorative (low beta, slow evaporation) settings
+    qreal f = colony / (qreal) (m_colonyCount - 1);
+    p.beta = base.beta * (0.5 + f);
+    p.ro = qBound(0.0, base.ro * (0.5 + f), 1.0);
+    return p;
+}
+
+void IslandModel::reset() {
+    // the colonies may still be in the middle of an epoch
+    m_epoch.waitForFinished();
+    qDeleteAll(m_colonies);
+    m_colonies.clear();
+    delete m_metricClosure;
+    m_metricClosure = nullptr;
+    m_c = 0;
+    emit cChanged();
+    m_shortestTripLength = HUGE_VAL;
+    emit shortestTripLengthChanged();
+}
+
+void IslandModel::step() {
+    if (m_epoch.isRunning())
+        return;
+
+    int interval = m_epochInterval = m_migrationInterval;
+    auto epoch = [interval](Colony *colony) {
+        for (int i = 0; i < interval; i++)
+            colony->cycle();
+    };
+    if (!m_colonies.isEmpty()) {
+        m_epoch.setFuture(QtConcurrent::map(m_colonies, epoch));
+        return;
+    }
+    if (aco()->towns().size() < 2)
+        return;
+
+    // only reading the canvas has to happen here, the closure and the colonies are built with the first epoch
+    m_instance = Instance::fromCanvas(aco());
+    Parameters base = Parameters::fromAlgorithm(aco()->algorithm());
+    QVector<Parameters> parameters;
+    QVector<quint32> seeds;
+    for (int i = 0; i < m_colonyCount; i++) {
+        parameters.append(parametersFor(i, base));
+        seeds.append(aco()->getRand() * std::numeric_limits<quint32>::max());
+    }
+    bool closure = m_closure;
+    m_epoch.setFuture(QtConcurrent::run([this, parameters, seeds, closure, epoch]() {
+        init(parameters, seeds, closure);
+        QtConcurrent::blockingMap(m_colonies, epoch);
+    }));
+}
+
+void IslandModel::epochFinished() {
+    // reset() while the epoch was running
+    if (m_colonies.isEmpty())
+        return;
+
+    m_c += m_epochInterval;
+    emit cChanged();
+
+    migrate();
+
+    Colony *shortest = m_colonies.first();
+    for (Colony *colony : m_colonies) {
+        if (colony->shortestTripLength() < shortest->shortestTripLength())
+            shortest = colony;
+    }
+    if (shortest->shortestTripLength() < m_shortestTripLength) {
+        m_shortestTripLength = shortest->shortestTripLength();
+        emit shortestTripLengthChanged();
+        if (m_metricClosure)
+            aco()->algorithm()->offerTrip(m_metricClosure->expand(shortest->shortestTrip()), m_shortestTripLength);
+        else
+            aco()->algorithm()->offerTrip(shortest->shortestTrip(), m_shortestTripLength);
+    }
+}
+
+void IslandModel::setColonyCount(int count) {
+    if (m_colonyCount != count && count > 0) {
+        m_colonyCount = count;
+        emit colonyCountChanged();
+        reset();
+    }
+}
+
+void IslandModel::setMigrationInterval(int interval) {
+    if (m_migrationInterval != interval && interval > 0) {
+        m_migrationInterval = interval;
+        emit migrationIntervalChanged();
+    }
+}
+
+void IslandModel::setMigrationTopology(int topology) {
+    if (m_migrationTopology != topology) {
+        m_migrationTopology = (IslandModel::Topologies) topology;
+        emit migrationTopologyChanged();
+    }
+}
+
+void IslandModel::setHeterogeneous(bool on) {
+    if (m_heterogeneous != on) {
+        m_heterogeneous = on;
+        emit heterogeneousChanged();
+        reset();
+    }
+}
+
+void IslandModel::setClosure(bool on) {
+    if (m_closure != on) {
+        m_closure = on;
+        emit closureChanged();
+        reset();
+    }
+}
+
+void IslandModel::init(const QVector<Parameters> &parameters, const QVector<quint32> &seeds, bool closure) {
+    const Instance *instance = &m_instance;
+    // on a sparse map the ants travel between towns over the shortest paths
+    if (closure && m_instance.sparse()) {
+        m_metricClosure = new Closure(&m_instance);
+        instance = m_metricClosure->instance();
+    }
+    for (int i = 0; i < parameters.size(); i++)
+        m_colonies.append(new Colony(instance, parameters[i], seeds[i]));
+}
+
+void IslandModel::migrate() {
+    const int count = m_colonies.size();
+    if (count < 2)
+        return;
+
+    // take a snapshot first so the result doesn't depend on the order of the colonies
+    QVector<QVector<int>> trips;
+    QVector<qreal> lengths;
+    for (Colony *colony : m_colonies) {
+        trips.append(colony->shortestTrip());
+        lengths.append(colony->shortestTripLength());
+    }
+
+    for (int i = 0; i < count; i++) {
+        int from = -1;
+        if (m_migrationTopology == Ring) {
+            from = (i + count - 1) % count;
+        }
+        else {
+            for (int j = 0; j < count; j++) {
+                if (j != i && (from < 0 || lengths[j] < lengths[from]))
+                    from = j;
+            }
+        }
+        if (lengths[from] < HUGE_VAL)
+            m_colonies[i]->migrate(trips[from], lengths[from]);
+    }
+}
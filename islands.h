@@ -0,0 +1,113 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef ISLANDS_H
+#define ISLANDS_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QList>
+
+#include "closure.h"
+#include "colony.h"
+
+class Aco;
+
+/**
+ * Island model: several independent colonies run in parallel threads and
+ * exchange their shortest trips every migrationInterval cycles. An epoch
+ * of migrationInterval cycles runs in the background, step() does nothing
+ * until the previous one has finished. The first epoch also builds the
+ * closure of a sparse map and the colonies.
+ */
+class IslandModel : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(int colonyCount READ colonyCount WRITE setColonyCount NOTIFY colonyCountChanged)
+    Q_PROPERTY(int migrationInterval READ migrationInterval WRITE setMigrationInterval NOTIFY migrationIntervalChanged)
+    Q_PROPERTY(int migrationTopology READ migrationTopology WRITE setMigrationTopology NOTIFY migrationTopologyChanged)
+    Q_PROPERTY(bool heterogeneous READ heterogeneous WRITE setHeterogeneous NOTIFY heterogeneousChanged)
+    Q_PROPERTY(bool closure READ closure WRITE setClosure NOTIFY closureChanged)
+    Q_PROPERTY(int c READ c NOTIFY cChanged)
+    Q_PROPERTY(qreal shortestTripLength READ shortestTripLength NOTIFY shortestTripLengthChanged)
+public:
+    enum Topologies {
+        Ring = 0,
+        AllToAll,
+    };
+    Q_ENUMS(Topologies)
+
+    IslandModel(Aco *parent);
+    ~IslandModel();
+
+    Aco *aco();
+
+    int colonyCount();
+    int migrationInterval();
+    int migrationTopology();
+    bool heterogeneous();
+    bool closure();
+    int c();
+    qreal shortestTripLength();
+
+    Parameters parametersFor(int colony, const Parameters &base);
+public slots:
+    void reset();
+    void step();
+
+    void setColonyCount(int count);
+    void setMigrationInterval(int interval);
+    void setMigrationTopology(int topology);
+    void setHeterogeneous(bool on);
+    void setClosure(bool on);
+signals:
+    void colonyCountChanged();
+    void migrationIntervalChanged();
+    void migrationTopologyChanged();
+    void heterogeneousChanged();
+    void closureChanged();
+    void cChanged();
+    void shortestTripLengthChanged();
+protected:
+    // runs on a thread of the pool with the first epoch
+    void init(const QVector<Parameters> &parameters, const QVector<quint32> &seeds, bool closure);
+    void migrate();
+    void epochFinished();
+
+    int m_colonyCount { 4 };
+    int m_migrationInterval { 10 };
+    Topologies m_migrationTopology { Ring };
+    bool m_heterogeneous { true };
+    bool m_closure { true };
+    int m_c { 0 };
+    qreal m_shortestTripLength { HUGE_VAL };
+
+    Instance m_instance { };
+    Closure *m_metricClosure { nullptr };
+    QList<Colony*> m_colonies { };
+    QFutureWatcher<void> m_epoch { };
+    int m_epochInterval { 0 };
+};
+
+#endif // ISLANDS_H
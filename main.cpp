@@ -23,13 +23,451 @@
  */
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
 #include <QQmlApplicationEngine>
+#include <QScopedPointer>
+#include <QThread>
+#include <QTextStream>
 #include <QtQml>
 
 #include "aco.h"
+#include "batch.h"
+#include "closure.h"
+#include "decomposition.h"
+#include "node.h"
+#include "recorder.h"
+#include "service.h"
+#include "solver.h"
+#include "transport.h"
+#include "tsplib.h"
+#include "tuner.h"
+
+// TSPLIB files are read directly, only maps in the format of the application need a canvas
+// a single colony needs the whole matrix, --bench doesn't run one on bigger instances
+static const int benchLimit = 5000;
+
+// an empty instance means the file couldn't be loaded, the reason is already printed
+static Instance loadInstance(Aco &aco, const QString &file)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+        QTextStream(stderr) << "Can't open " << file << ": " << f.errorString() << endl;
+        return Instance();
+    }
+    Tsplib tsplib;
+    if (Tsplib::parse(f.readAll(), tsplib)) {
+        // Instance::fromCanvas() builds the candidate lists itself
+        tsplib.instance.buildNeighbours(Instance::defaultNeighbourCount);
+        return tsplib.instance;
+    }
+    if (!tsplib.error.isEmpty()) {
+        QTextStream(stderr) << "Can't load " << file << ": " << tsplib.error << endl;
+        return Instance();
+    }
+    if (!aco.loadFrom(QUrl::fromLocalFile(file)) || aco.towns().isEmpty()) {
+        QTextStream(stderr) << "No towns in " << file << endl;
+        return Instance();
+    }
+    return Instance::fromCanvas(&aco);
+}
+
+static int runNode(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a colony without the user interface and exchanges trips with its peers.");
+    parser.addHelpOption();
+    QCommandLineOption nodeOption("node", "Instance to solve.", "file");
+    QCommandLineOption listenOption("listen", "Address to receive on (inprocess:<hub>, local:<name>, tcp:[<host>:]<port>).", "address");
+    QCommandLineOption peerOption("peer", "Address of a peer to send to, can be repeated.", "address");
+    QCommandLineOption idOption("id", "Identifier of this node.", "id", QString::number(QCoreApplication::applicationPid()));
+    QCommandLineOption cyclesOption("cycles", "Number of cycles to run, 0 runs until killed.", "count", "0");
+    QCommandLineOption intervalOption("exchange-interval", "Number of cycles between two messages to the peers.", "count", "10");
+    QCommandLineOption presetOption("preset", "Parameters of the algorithm.", "file");
+    parser.addOption(nodeOption);
+    parser.addOption(listenOption);
+    parser.addOption(peerOption);
+    parser.addOption(idOption);
+    parser.addOption(cyclesOption);
+    parser.addOption(intervalOption);
+    parser.addOption(presetOption);
+    parser.process(app);
+
+    Aco aco;
+    Instance instance = loadInstance(aco, parser.value(nodeOption));
+    if (instance.size() == 0)
+        return 1;
+    if (parser.isSet(presetOption) && !aco.loadPreset(QUrl::fromLocalFile(parser.value(presetOption))))
+        return 1;
+
+    Transport *transport = Transport::create(parser.value(listenOption), &app);
+    if (!transport)
+        return 1;
+    for (const QString &peer : parser.values(peerOption))
+        transport->connectToPeer(peer);
+
+    Node node(instance, Parameters::fromAlgorithm(aco.algorithm()), transport, parser.value(idOption).toUInt());
+    node.setExchangeInterval(parser.value(intervalOption).toInt());
+    QObject::connect(&node, &Node::improved, &app, [](qreal length, int c) {
+        QTextStream(stdout) << c << " " << length << endl;
+    });
+    QObject::connect(&node, &Node::finished, &app, &QCoreApplication::quit);
+    node.start(parser.value(cyclesOption).toInt());
+
+    return app.exec();
+}
+
+static int runSolve(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Solves an instance within a time budget and prints every improvement.");
+    parser.addHelpOption();
+    QCommandLineOption solveOption("solve", "Instance to solve.", "file");
+    QCommandLineOption timeOption("time", "Time budget in milliseconds, a negative one runs until another limit is hit.", "ms", "1000");
+    QCommandLineOption stagnationOption("stagnation", "Stop after this many cycles without an improvement, 0 never stops.", "count", "0");
+    QCommandLineOption cyclesOption("cycles", "Maximum number of cycles, 0 is unlimited.", "count", "0");
+    QCommandLineOption seedOption("seed", "Seed of the random number generator.", "seed", "0");
+    QCommandLineOption presetOption("preset", "Parameters of the algorithm.", "file");
+    QCommandLineOption convergedOption("converged", "Stop once the branching factor drops to this value, 0 never stops.", "branching", "0");
+    QCommandLineOption restartBranchingOption("restart-branching", "Reset the trails when the branching factor drops below this value.", "branching");
+    QCommandLineOption restartIdleOption("restart-idle", "Reset the trails after this many cycles without an improvement.", "count");
+    QCommandLineOption threadsOption("threads", "Number of threads the ants build their trips in.", "count", "1");
+    QCommandLineOption deterministicOption("deterministic", "Give the same result for a seed with any number of threads, only with --cycles or --stagnation.");
+    QCommandLineOption recordOption("record", "Record the run into a file that can be replayed in the application.", "file");
+    QCommandLineOption recordIntervalOption("record-interval", "Record every this many cycles.", "count", "10");
+    parser.addOption(solveOption);
+    parser.addOption(timeOption);
+    parser.addOption(stagnationOption);
+    parser.addOption(cyclesOption);
+    parser.addOption(seedOption);
+    parser.addOption(presetOption);
+    parser.addOption(convergedOption);
+    parser.addOption(restartBranchingOption);
+    parser.addOption(restartIdleOption);
+    parser.addOption(threadsOption);
+    parser.addOption(deterministicOption);
+    parser.addOption(recordOption);
+    parser.addOption(recordIntervalOption);
+    parser.process(app);
+
+    Aco aco;
+    Instance instance = loadInstance(aco, parser.value(solveOption));
+    if (instance.size() == 0)
+        return 1;
+    if (parser.isSet(presetOption) && !aco.loadPreset(QUrl::fromLocalFile(parser.value(presetOption))))
+        return 1;
+    if (parser.isSet(restartBranchingOption))
+        aco.algorithm()->setRestartBranching(parser.value(restartBranchingOption).toDouble());
+    if (parser.isSet(restartIdleOption))
+        aco.algorithm()->setRestartIdle(parser.value(restartIdleOption).toInt());
+
+    // ants on a sparse map would keep running into dead ends, let them work on the shortest paths instead
+    QScopedPointer<Closure> closure(instance.sparse() ? new Closure(&instance) : nullptr);
+
+    Solver solver(Parameters::fromAlgorithm(aco.algorithm()), parser.value(seedOption).toUInt());
+    solver.setStagnationLimit(parser.value(stagnationOption).toInt());
+    solver.setMaxCycles(parser.value(cyclesOption).toInt());
+    solver.setConvergenceLimit(parser.value(convergedOption).toDouble());
+    solver.setThreads(parser.value(threadsOption).toInt());
+    solver.setDeterministic(parser.isSet(deterministicOption));
+    if (parser.isSet(deterministicOption) && parser.value(timeOption).toLongLong() >= 0)
+        QTextStream(stderr) << "The time budget may stop a deterministic run at a different cycle, use --time -1" << endl;
+    if (parser.value(timeOption).toLongLong() < 0 && solver.stagnationLimit() == 0 && solver.maxCycles() == 0) {
+        QTextStream(stderr) << "Refusing to run without any limit" << endl;
+        return 1;
+    }
+
+    const Instance &solved = closure ? *closure->instance() : instance;
+    QScopedPointer<Recorder> recorder;
+    if (parser.isSet(recordOption)) {
+        recorder.reset(new Recorder(parser.value(recordOption), parser.value(recordIntervalOption).toInt()));
+        if (!recorder->open(&solved)) {
+            QTextStream(stderr) << "Can't record into " << parser.value(recordOption) << ": " << recorder->error() << endl;
+            return 1;
+        }
+        solver.setRecorder(recorder.data());
+    }
+
+    QTextStream out(stdout);
+    Solver::Result result = solver.solve(solved, parser.value(timeOption).toLongLong(),
+                                         [&out](const Solver::Result &improvement) {
+        out << improvement.c << " " << improvement.length << " " << improvement.elapsed << endl;
+    });
+    if (recorder) {
+        recorder->finish();
+        QTextStream(stderr) << "recorded " << recorder->frames() << " frames, dropped " << recorder->dropped() << endl;
+    }
+    QTextStream(stderr) << "cycles " << result.c << ", branching " << result.convergence.branching
+                        << ", entropy " << result.convergence.entropy << ", idle " << result.convergence.idleCycles
+                        << ", restarts " << result.convergence.restarts << endl;
+    if (result.trip.isEmpty())
+        return 2;
+
+    QStringList towns;
+    for (int town : closure ? closure->expand(result.trip) : result.trip)
+        towns.append(QString::number(town));
+    out << towns.join(" ") << endl;
+    return 0;
+}
+
+static int runBatch(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Solves many instances at once and prints the length of every shortest trip.");
+    parser.addHelpOption();
+    QCommandLineOption batchOption("batch", "Solve the files given as arguments.");
+    QCommandLineOption timeOption("time", "Time budget of every instance in milliseconds, negative for none.", "ms", "-1");
+    QCommandLineOption stagnationOption("stagnation", "Stop an instance after this many cycles without an improvement.", "count", "0");
+    QCommandLineOption cyclesOption("cycles", "Maximum number of cycles of every instance.", "count", "100");
+    QCommandLineOption threadsOption("threads", "Number of threads.", "count", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption presetOption("preset", "Parameters of the algorithm.", "file");
+    parser.addOption(batchOption);
+    parser.addOption(timeOption);
+    parser.addOption(stagnationOption);
+    parser.addOption(cyclesOption);
+    parser.addOption(threadsOption);
+    parser.addOption(presetOption);
+    parser.addPositionalArgument("files", "Instances to solve.", "files...");
+    parser.process(app);
+
+    Aco aco;
+    if (parser.isSet(presetOption) && !aco.loadPreset(QUrl::fromLocalFile(parser.value(presetOption))))
+        return 1;
+    Batch batch(Parameters::fromAlgorithm(aco.algorithm()));
+    for (const QString &file : parser.positionalArguments()) {
+        Instance instance = loadInstance(aco, file);
+        if (instance.size() == 0)
+            return 1;
+        batch.add(instance);
+    }
+    batch.setTimeout(parser.value(timeOption).toLongLong());
+    batch.setStagnationLimit(parser.value(stagnationOption).toInt());
+    batch.setMaxCycles(parser.value(cyclesOption).toInt());
+    if (batch.timeout() < 0 && batch.stagnationLimit() == 0 && batch.maxCycles() == 0) {
+        QTextStream(stderr) << "Refusing to run without any limit" << endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<Solver::Result> results = batch.solve(parser.value(threadsOption).toInt());
+    qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+
+    QTextStream out(stdout);
+    for (int i = 0; i < results.size(); i++)
+        out << parser.positionalArguments()[i] << " " << results[i].length << " " << results[i].c << endl;
+    QTextStream(stderr) << results.size() << " instances in " << elapsed << " ms, " << results.size() * 1000.0 / elapsed << " instances/s" << endl;
+    return 0;
+}
+
+static int runTune(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Races parameters of the algorithm on a set of training instances and writes the best ones as a preset.");
+    parser.addHelpOption();
+    QCommandLineOption tuneOption("tune", "Tune on the files given as arguments.");
+    QCommandLineOption outputOption("output", "File to write the preset to, standard output by default.", "file");
+    QCommandLineOption presetOption("preset", "Parameters to start from.", "file");
+    QCommandLineOption iterationsOption("iterations", "Number of races.", "count", "4");
+    QCommandLineOption candidatesOption("candidates", "Number of configurations in every race.", "count", "16");
+    QCommandLineOption blocksOption("blocks", "Maximum number of instances solved in a race, the files are repeated with new seeds.", "count", "20");
+    QCommandLineOption cyclesOption("cycles", "Number of cycles of every run.", "count", "100");
+    QCommandLineOption seedOption("seed", "Seed of the random number generator.", "seed", "0");
+    parser.addOption(tuneOption);
+    parser.addOption(outputOption);
+    parser.addOption(presetOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(candidatesOption);
+    parser.addOption(blocksOption);
+    parser.addOption(cyclesOption);
+    parser.addOption(seedOption);
+    parser.addPositionalArgument("files", "Training instances.", "files...");
+    parser.process(app);
+
+    Aco aco;
+    if (parser.isSet(presetOption) && !aco.loadPreset(QUrl::fromLocalFile(parser.value(presetOption))))
+        return 1;
+    Parameters base = Parameters::fromAlgorithm(aco.algorithm());
+    QVector<Instance> instances;
+    for (const QString &file : parser.positionalArguments()) {
+        instances.append(loadInstance(aco, file));
+        if (instances.last().size() == 0)
+            return 1;
+    }
+    if (instances.isEmpty()) {
+        QTextStream(stderr) << "No training instances given" << endl;
+        return 1;
+    }
+
+    Tuner tuner(instances, base, parser.value(seedOption).toUInt());
+    tuner.setIterations(parser.value(iterationsOption).toInt());
+    tuner.setCandidateCount(parser.value(candidatesOption).toInt());
+    tuner.setMaxBlocks(parser.value(blocksOption).toInt());
+    tuner.setCycles(parser.value(cyclesOption).toInt());
+    QTextStream err(stderr);
+    Parameters best = tuner.tune([&err](const QString &message) {
+        err << message << endl;
+    });
+
+    QByteArray preset = QJsonDocument(best.toJson()).toJson();
+    if (!parser.isSet(outputOption)) {
+        QTextStream(stdout) << preset;
+        return 0;
+    }
+    QFile f(parser.value(outputOption));
+    if (!f.open(QIODevice::WriteOnly)) {
+        err << "Can't write " << parser.value(outputOption) << endl;
+        return 1;
+    }
+    f.write(preset);
+    return 0;
+}
+
+static int runDecompose(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Solves a big instance by clusters and joins their trips.");
+    parser.addHelpOption();
+    QCommandLineOption decomposeOption("decompose", "Instance to solve.", "file");
+    QCommandLineOption clusterSizeOption("cluster-size", "Number of towns in a cluster.", "count", QString::number(Decomposition::defaultClusterSize));
+    QCommandLineOption timeOption("time", "Time budget of every cluster in milliseconds, negative for none.", "ms", "-1");
+    QCommandLineOption stagnationOption("stagnation", "Stop a cluster after this many cycles without an improvement.", "count", "0");
+    QCommandLineOption cyclesOption("cycles", "Maximum number of cycles of every cluster.", "count", "100");
+    QCommandLineOption threadsOption("threads", "Number of threads.", "count", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption seedOption("seed", "Seed of the random number generator.", "seed", "0");
+    QCommandLineOption presetOption("preset", "Parameters of the algorithm.", "file");
+    QCommandLineOption benchOption("bench", "Compare with a single colony given the same time instead of printing the trip.");
+    parser.addOption(decomposeOption);
+    parser.addOption(clusterSizeOption);
+    parser.addOption(timeOption);
+    parser.addOption(stagnationOption);
+    parser.addOption(cyclesOption);
+    parser.addOption(threadsOption);
+    parser.addOption(seedOption);
+    parser.addOption(presetOption);
+    parser.addOption(benchOption);
+    parser.process(app);
+
+    Aco aco;
+    if (parser.isSet(presetOption) && !aco.loadPreset(QUrl::fromLocalFile(parser.value(presetOption))))
+        return 1;
+
+    // only the coordinates are read, a matrix of a big instance wouldn't fit into memory
+    QFile f(parser.value(decomposeOption));
+    if (!f.open(QIODevice::ReadOnly)) {
+        QTextStream(stderr) << "Can't open " << f.fileName() << ": " << f.errorString() << endl;
+        return 1;
+    }
+    Tsplib tsplib;
+    if (!Tsplib::parse(f.readAll(), tsplib, false)) {
+        QTextStream(stderr) << "Can't decompose " << f.fileName() << ": "
+                            << (tsplib.error.isEmpty() ? QString("Not a TSPLIB instance with coordinates") : tsplib.error) << endl;
+        return 1;
+    }
+    const QVector<qreal> &x = tsplib.x;
+    const QVector<qreal> &y = tsplib.y;
+    Decomposition::Distance distance = [&tsplib](int a, int b) {
+        return Tsplib::distance(tsplib.metric, tsplib.x[a], tsplib.y[a], tsplib.x[b], tsplib.y[b]);
+    };
+
+    Decomposition decomposition(x, y, distance, Parameters::fromAlgorithm(aco.algorithm()), parser.value(seedOption).toUInt());
+    decomposition.setClusterSize(parser.value(clusterSizeOption).toInt());
+    decomposition.setTimeout(parser.value(timeOption).toLongLong());
+    decomposition.setStagnationLimit(parser.value(stagnationOption).toInt());
+    decomposition.setMaxCycles(parser.value(cyclesOption).toInt());
+    if (parser.value(timeOption).toLongLong() < 0 && parser.value(stagnationOption).toInt() <= 0
+            && parser.value(cyclesOption).toInt() <= 0) {
+        QTextStream(stderr) << "Refusing to run without any limit" << endl;
+        return 1;
+    }
+    Decomposition::Result result = decomposition.solve(parser.value(threadsOption).toInt());
+    QTextStream(stderr) << x.size() << " towns in " << result.clusters << " clusters, partitioning " << result.partitioning
+                        << " ms, solving " << result.solving << " ms, repairing " << result.repairing << " ms with "
+                        << result.moves << " moves" << endl;
+
+    QTextStream out(stdout);
+    if (!parser.isSet(benchOption)) {
+        QStringList towns;
+        for (int town : result.trip)
+            towns.append(QString::number(town));
+        out << result.length << " " << result.elapsed << endl;
+        out << towns.join(" ") << endl;
+        return 0;
+    }
+
+    // the single colony gets as much time as the whole decomposition took
+    out << "method length ms" << endl;
+    out << "decomposition " << result.length << " " << result.elapsed << endl;
+    if (x.size() > benchLimit) {
+        out << "single - -" << endl;
+        QTextStream(stderr) << "Not running a single colony on more than " << benchLimit << " towns" << endl;
+        return 0;
+    }
+    Instance instance = decomposition.instance();
+    Solver solver(Parameters::fromAlgorithm(aco.algorithm()), parser.value(seedOption).toUInt());
+    Solver::Result single = solver.solve(instance, qMax<qint64>(1, result.elapsed));
+    out << "single " << single.length << " " << single.elapsed << endl;
+    QTextStream(stderr) << "single colony ran " << single.c << " cycles, decomposition / single: length " << result.length / single.length
+                        << ", time " << qreal(result.elapsed) / qMax<qint64>(1, single.elapsed) << endl;
+    return 0;
+}
+
+static int runServe(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Solves instances posted over HTTP on localhost.");
+    parser.addHelpOption();
+    QCommandLineOption serveOption("serve", "Port to listen on, 0 picks a free one.", "port", "8080");
+    QCommandLineOption threadsOption("threads", "Number of worker threads shared by all jobs.", "count", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption jobThreadsOption("job-threads", "Maximum number of threads of a single job.", "count", QString::number(QThread::idealThreadCount()));
+    parser.addOption(serveOption);
+    parser.addOption(threadsOption);
+    parser.addOption(jobThreadsOption);
+    parser.process(app);
+
+    Service service;
+    service.pool()->setMaxThreadCount(qMax(1, parser.value(threadsOption).toInt()));
+    service.setMaxThreadsPerJob(parser.value(jobThreadsOption).toInt());
+    if (!service.listen(parser.value(serveOption).toUShort())) {
+        QTextStream(stderr) << "Can't listen on port " << parser.value(serveOption) << endl;
+        return 1;
+    }
+    QTextStream(stdout) << "Listening on http://localhost:" << service.port() << endl;
+
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--node") == 0)
+            return runNode(argc, argv);
+        if (qstrcmp(argv[i], "--solve") == 0)
+            return runSolve(argc, argv);
+        if (qstrcmp(argv[i], "--batch") == 0)
+            return runBatch(argc, argv);
+        if (qstrcmp(argv[i], "--tune") == 0)
+            return runTune(argc, argv);
+        if (qstrcmp(argv[i], "--decompose") == 0)
+            return runDecompose(argc, argv);
+        if (qstrcmp(argv[i], "--serve") == 0)
+            return runServe(argc, argv);
+    }
+
     QApplication app(argc, argv);
 
     qmlRegisterType<Aco>("fit.sfc.aco", 1, 0, "Aco");
@@ -38,6 +476,8 @@ int main(int argc, char *argv[])
     qmlRegisterUncreatableType<Ant>("fit.sfc.aco", 1, 0, "Ant", "Use the defined API to create ants");
     qmlRegisterUncreatableType<Canvas>("fit.sfc.aco", 1, 0, "Canvas", "Use the defined API to create a canvas");
     qmlRegisterUncreatableType<Algorithm>("fit.sfc.aco", 1, 0, "Algorithm", "Use the defined API to create algorithms");
+    qmlRegisterUncreatableType<IslandModel>("fit.sfc.aco", 1, 0, "IslandModel", "Use the defined API to create island models");
+    qmlRegisterUncreatableType<Replay>("fit.sfc.aco", 1, 0, "Replay", "Use the defined API to replay runs");
 
     QQmlApplicationEngine engine;
     engine.load(QUrl(QStringLiteral("qrc:/main.qml")));
@@ -70,6 +70,32 @@ ApplicationWindow {
                     fileDialog.open()
                 }
             }
+            FileDialog {
+                id: presetDialog
+                nameFilters: [ "Presets (*.json)", "All files (*)" ]
+                onAccepted: {
+                    if (selectExisting)
+                        aco.loadPreset(fileUrl)
+                    else
+                        aco.savePreset(fileUrl)
+                }
+            }
+            ToolButton {
+                id: loadPresetButton
+                text: "Load Preset"
+                onClicked: {
+                    presetDialog.selectExisting = true
+                    presetDialog.open()
+                }
+            }
+            ToolButton {
+                id: savePresetButton
+                text: "Save Preset"
+                onClicked: {
+                    presetDialog.selectExisting = false
+                    presetDialog.open()
+                }
+            }
             Rectangle {
                 color: "#888888"
                 width: 1
@@ -80,7 +106,10 @@ ApplicationWindow {
             ToolButton {
                 id: resetButton
                 text: "Reset"
-                onClicked: aco.algorithm.reset()
+                onClicked: {
+                    aco.algorithm.reset()
+                    aco.islands.reset()
+                }
             }
             ToolButton {
                 id: initButton
@@ -152,6 +181,75 @@ ApplicationWindow {
                 id: cycleLimit
                 text: "cycles"
             }
+            TextField {
+                text: "λ " + aco.algorithm.branching.toFixed(2) + "  H " + aco.algorithm.entropy.toFixed(2) + "  idle " + aco.algorithm.idleCycles + "  restarts " + aco.algorithm.restarts
+                enabled: false
+                readOnly: true
+                width: 220
+            }
+            Rectangle {
+                color: "#888888"
+                width: 1
+                y: 2
+                height: parent.height - 4
+            }
+
+            ToolButton {
+                id: islandsButton
+                text: "Islands"
+                checkable: true
+                Timer {
+                    id: islandsTimer
+                    interval: aco.animationSpeed * 1.1
+                    repeat: true
+                    running: islandsButton.checked
+                    onTriggered: aco.islands.step()
+                }
+            }
+            TextField {
+                text: aco.islands.c
+                enabled: false
+                readOnly: true
+                width: 50
+            }
+            Rectangle {
+                color: "#888888"
+                width: 1
+                y: 2
+                height: parent.height - 4
+            }
+            FileDialog {
+                id: replayDialog
+                nameFilters: [ "Recorded runs (*.acor)", "All files (*)" ]
+                onAccepted: aco.replay.load(fileUrl)
+            }
+            ToolButton {
+                id: replayButton
+                text: aco.replay.frameCount > 0 ? "Close Run" : "Load Run"
+                onClicked: {
+                    if (aco.replay.frameCount > 0)
+                        aco.replay.close()
+                    else
+                        replayDialog.open()
+                }
+            }
+            Slider {
+                id: replaySlider
+                visible: aco.replay.frameCount > 0
+                width: 200
+                minimumValue: 0
+                maximumValue: Math.max(0, aco.replay.frameCount - 1)
+                stepSize: 1
+                value: aco.replay.frame
+                onValueChanged: aco.replay.frame = value
+            }
+            TextField {
+                visible: aco.replay.frameCount > 0 || aco.replay.error.length > 0
+                text: aco.replay.error.length > 0 ? aco.replay.error : "c " + aco.replay.c + "  " + aco.replay.shortestTripLength.toFixed(2) + "  λ " + aco.replay.branching.toFixed(2)
+                enabled: false
+                readOnly: true
+                width: 200
+            }
         }
     }
 
@@ -233,6 +331,32 @@ ApplicationWindow {
                         id: displayShortestPath
                         checked: true
                     }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "Fill Paths:"
+                        MouseArea {
+                            anchors.fill: parent
+                            onClicked: aco.fillPaths = !aco.fillPaths
+                        }
+                    }
+                    CheckBox {
+                        checked: aco.fillPaths
+                        onClicked: aco.fillPaths = checked
+                    }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "One-way Paths:"
+                        MouseArea {
+                            anchors.fill: parent
+                            onClicked: aco.directed = !aco.directed
+                        }
+                    }
+                    CheckBox {
+                        checked: aco.directed
+                        onClicked: aco.directed = checked
+                    }
                     Text {
                         width: antCountText.width
                         horizontalAlignment: Text.AlignRight
@@ -381,6 +505,76 @@ ApplicationWindow {
                         model: [ "Ant Cycle", "Ant-Density", "Ant-Quantity" ]
                         currentIndex: aco.chosenAlgo
                     }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "Restart Below λ:"
+                    }
+                    SpinBox {
+                        id: restartBranchingInput
+                        width: antCountInput.width
+                        value: aco.algorithm.restartBranching
+                        stepSize: 0.05
+                        decimals: 2
+                        minimumValue: 0.0
+                        maximumValue: 100.0
+                    }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "Restart When Idle:"
+                    }
+                    SpinBox {
+                        id: restartIdleInput
+                        width: antCountInput.width
+                        value: aco.algorithm.restartIdle
+                        minimumValue: 0
+                        maximumValue: 9999999
+                    }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "Colonies:"
+                    }
+                    SpinBox {
+                        id: colonyCountInput
+                        width: antCountInput.width
+                        value: aco.islands.colonyCount
+                        minimumValue: 1
+                        maximumValue: 256
+                    }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "Migration Interval:"
+                    }
+                    SpinBox {
+                        id: migrationIntervalInput
+                        width: antCountInput.width
+                        value: aco.islands.migrationInterval
+                        minimumValue: 1
+                        maximumValue: 9999999
+                    }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "Topology:"
+                    }
+                    ComboBox {
+                        id: topologyCB
+                        width: antCountInput.width
+                        model: [ "Ring", "All-to-All" ]
+                        currentIndex: aco.islands.migrationTopology
+                    }
+                    Text {
+                        width: antCountText.width
+                        horizontalAlignment: Text.AlignRight
+                        text: "Shortest Paths:"
+                    }
+                    CheckBox {
+                        id: closureInput
+                        checked: aco.islands.closure
+                    }
                 }
                 Row {
                     id: buttonRow
@@ -399,6 +593,12 @@ ApplicationWindow {
                             antCountInput.value = aco.algorithm.antCount
                             roInput.value = aco.algorithm.ro
                             algoCB.currentIndex = aco.chosenAlgo
+                            restartBranchingInput.value = aco.algorithm.restartBranching
+                            restartIdleInput.value = aco.algorithm.restartIdle
+                            colonyCountInput.value = aco.islands.colonyCount
+                            migrationIntervalInput.value = aco.islands.migrationInterval
+                            topologyCB.currentIndex = aco.islands.migrationTopology
+                            closureInput.checked = aco.islands.closure
                         }
                     }
                     Button {
@@ -411,6 +611,12 @@ ApplicationWindow {
                             aco.algorithm.antCount = antCountInput.value
                             aco.algorithm.ro = roInput.value
                             aco.chosenAlgo = algoCB.currentIndex
+                            aco.algorithm.restartBranching = restartBranchingInput.value
+                            aco.algorithm.restartIdle = restartIdleInput.value
+                            aco.islands.colonyCount = colonyCountInput.value
+                            aco.islands.migrationInterval = migrationIntervalInput.value
+                            aco.islands.migrationTopology = topologyCB.currentIndex
+                            aco.islands.closure = closureInput.checked
                         }
                     }
 
@@ -425,7 +631,7 @@ ApplicationWindow {
                 Text {
                     width: parent.width
                     wrapMode: Text.WordWrap
-                    text: "<b>Clicking</b> changes focus and enables editable fields.<br><b>Dragging</b> moves the towns<br><b>Double clicking</b> adds a new town.<br><b><font color='grey'>Right click and dragging</font></b><font color='grey'> adds paths between towns or deletes them if they are already present.</font><br><b>Middle button</b> deletes existing towns and their paths."
+                    text: "<b>Clicking</b> changes focus and enables editable fields.<br><b>Dragging</b> moves the towns<br><b>Double clicking</b> adds a new town.<br><b>Right click and dragging</b> adds paths between towns or deletes them if they are already present (only with Fill Paths off).<br><b>Middle button</b> deletes existing towns and their paths."
                 }
             }
         }
@@ -476,6 +682,7 @@ ApplicationWindow {
                         model: displayTrails.checked ? aco.paths : null
                         delegate: Line {
                             height: aco.townSize / 2
+                            offset: aco.directed ? aco.townSize / 4 : 0
                             gradient: Gradient {
                                 GradientStop { position: 0.5 - Math.sqrt(trail - aco.initialTau) / 10.0; color: "transparent" }
                                 GradientStop { position: 0.5; color: "#44dd44" }
@@ -491,6 +698,7 @@ ApplicationWindow {
                         model: displayDistance.checked ? aco.paths : null
                         delegate: Line {
                             height: 2
+                            offset: aco.directed ? aco.townSize / 4 : 0
                             color: "#cccccc"
                             x1: a.pos_x + aco.townSize / 2
                             y1: a.pos_y + aco.townSize / 2
@@ -532,6 +740,7 @@ ApplicationWindow {
                         model: displayShortestPath.checked ? aco.algorithm.shortestTrip : null
                         delegate: Line {
                             height: 2
+                            offset: aco.directed ? aco.townSize / 4 : 0
                             color: "#ff8888"
                             x1: a.pos_x + aco.townSize / 2
                             y1: a.pos_y + aco.townSize / 2
@@ -0,0 +1,132 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "node.h"
+#include "transport.h"
+
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+#include <random>
+
+Node::Node(const Instance &instance, const Parameters &parameters, Transport *transport, quint32 id, QObject *parent)
+    : QObject(parent), m_instance(instance), m_colony(&m_instance, parameters, std::random_device()()),
+      m_transport(transport), m_id(id) {
+    connect(transport, &Transport::received, this, &Node::receive);
+}
+
+Node::~Node() {
+    stop();
+    m_future.waitForFinished();
+}
+
+int Node::exchangeInterval() {
+    return m_exchangeInterval;
+}
+
+int Node::summarySize() {
+    return m_summarySize;
+}
+
+qreal Node::mergeWeight() {
+    return m_mergeWeight;
+}
+
+QVector<int> Node::shortestTrip() {
+    QMutexLocker locker(&m_mutex);
+    return m_shortestTrip;
+}
+
+qreal Node::shortestTripLength() {
+    QMutexLocker locker(&m_mutex);
+    return m_shortestTripLength;
+}
+
+void Node::setExchangeInterval(int interval) {
+    m_exchangeInterval = qMax(1, interval);
+}
+
+void Node::setSummarySize(int k) {
+    m_summarySize = qMax(0, k);
+}
+
+void Node::setMergeWeight(qreal weight) {
+    m_mergeWeight = qBound(0.0, weight, 1.0);
+}
+
+void Node::start(int cycles) {
+    if (m_future.isRunning())
+        return;
+    m_stopped.store(0);
+    m_future = QtConcurrent::run([this, cycles]() {
+        run(cycles);
+    });
+}
+
+void Node::stop() {
+    m_stopped.store(1);
+}
+
+void Node::receive(const QByteArray &datagram) {
+    QMutexLocker locker(&m_mutex);
+    // only the latest news matter when the colony can't keep up
+    if (m_inbox.size() >= inboxLimit)
+        m_inbox.removeFirst();
+    m_inbox.append(datagram);
+}
+
+void Node::run(int cycles) {
+    for (int i = 0; (cycles <= 0 || i < cycles) && !m_stopped.load(); i++) {
+        qreal shortest = m_colony.shortestTripLength();
+
+        QList<QByteArray> inbox;
+        m_mutex.lock();
+        inbox.swap(m_inbox);
+        m_mutex.unlock();
+        for (const QByteArray &datagram : inbox) {
+            Message message;
+            if (Message::decode(datagram, message) && message.node != m_id)
+                message.mergeInto(m_colony, m_mergeWeight);
+        }
+
+        m_colony.cycle();
+
+        if (m_colony.shortestTripLength() < shortest) {
+            m_mutex.lock();
+            m_shortestTrip = m_colony.shortestTrip();
+            m_shortestTripLength = m_colony.shortestTripLength();
+            m_mutex.unlock();
+            emit improved(m_colony.shortestTripLength(), m_colony.c());
+        }
+
+        if (m_colony.c() % m_exchangeInterval == 0) {
+            Message message;
+            message.node = m_id;
+            message.summarize(m_colony, m_summarySize);
+            QMetaObject::invokeMethod(m_transport, "send", Qt::QueuedConnection, Q_ARG(QByteArray, message.encode()));
+        }
+    }
+    emit finished();
+}
@@ -0,0 +1,90 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef NODE_H
+#define NODE_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+
+#include "colony.h"
+
+class Transport;
+
+/**
+ * A colony exchanging its shortest trip and a summary of its trails with
+ * the peers reachable through a Transport. The cycles run on a worker
+ * thread, received datagrams are only queued and merged between cycles
+ * so slow or missing peers never hold the colony back.
+ */
+class Node : public QObject {
+    Q_OBJECT
+public:
+    static const int inboxLimit = 16;
+
+    Node(const Instance &instance, const Parameters &parameters, Transport *transport, quint32 id, QObject *parent = nullptr);
+    ~Node();
+
+    int exchangeInterval();
+    int summarySize();
+    qreal mergeWeight();
+    QVector<int> shortestTrip();
+    qreal shortestTripLength();
+
+    void setExchangeInterval(int interval);
+    void setSummarySize(int k);
+    void setMergeWeight(qreal weight);
+public slots:
+    void start(int cycles = 0);
+    void stop();
+signals:
+    void improved(qreal length, int c);
+    void finished();
+private slots:
+    void receive(const QByteArray &datagram);
+private:
+    void run(int cycles);
+
+    Instance m_instance;
+    Colony m_colony;
+    Transport *m_transport { nullptr };
+    quint32 m_id { 0 };
+
+    int m_exchangeInterval { 10 };
+    int m_summarySize { 8 };
+    qreal m_mergeWeight { 0.1 };
+
+    QMutex m_mutex { };
+    QList<QByteArray> m_inbox { };
+    QVector<int> m_shortestTrip { };
+    qreal m_shortestTripLength { HUGE_VAL };
+    QAtomicInt m_stopped { 0 };
+    QFuture<void> m_future { };
+};
+
+#endif // NODE_H
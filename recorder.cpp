@@ -0,0 +1,281 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "recorder.h"
+
+#include <QDataStream>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <cstring>
+
+Recorder::Recorder(const QString &fileName, int interval)
+    : m_interval(qMax(1, interval)), m_file(fileName) {
+    m_pool.setMaxThreadCount(1);
+}
+
+Recorder::~Recorder() {
+    finish();
+}
+
+QString Recorder::error() const {
+    return m_error;
+}
+
+int Recorder::interval() const {
+    return m_interval;
+}
+
+int Recorder::frames() const {
+    QMutexLocker locker(&m_mutex);
+    return m_frames;
+}
+
+int Recorder::dropped() const {
+    QMutexLocker locker(&m_mutex);
+    return m_dropped;
+}
+
+int Recorder::headerSize() {
+    return 5 * sizeof(quint32) + sizeof(quint8);
+}
+
+bool Recorder::open(const Instance *instance) {
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_edges = instance->edgeCount();
+    m_lastTrails = QVector<float>(m_edges, 0.0f);
+
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << magic << version << quint32(instance->size()) << quint32(m_edges)
+           << quint8(instance->sparse()) << quint32(m_interval);
+    if (!append(header.constData(), header.size()))
+        return false;
+
+    m_finishing = false;
+    m_open = true;
+    m_writer = QtConcurrent::run(&m_pool, [this]() { write(); });
+    return true;
+}
+
+void Recorder::record(const Colony &colony) {
+    if (!m_open || colony.c() % m_interval != 0)
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_queue.size() >= maxQueued || m_finishing) {
+        m_dropped++;
+        return;
+    }
+    Snapshot snapshot;
+    if (!m_spare.isEmpty())
+        snapshot.trails = m_spare.takeLast();
+    locker.unlock();
+
+    // the copy is all the colony waits for
+    snapshot.trails.resize(m_edges);
+    colony.copyTrails(snapshot.trails.data());
+    snapshot.c = colony.c();
+    snapshot.length = colony.shortestTripLength();
+    snapshot.convergence = colony.convergence();
+    snapshot.trip = colony.shortestTrip();
+
+    locker.relock();
+    m_queue.enqueue(snapshot);
+    m_queued.wakeOne();
+}
+
+void Recorder::finish() {
+    if (!m_file.isOpen())
+        return;
+    m_open = false;
+    m_mutex.lock();
+    m_finishing = true;
+    m_queued.wakeOne();
+    m_mutex.unlock();
+    m_writer.waitForFinished();
+
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = nullptr;
+    m_file.resize(m_size);
+    m_file.close();
+}
+
+void Recorder::write() {
+    int written = 0;
+    while (true) {
+        Snapshot snapshot;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_finishing)
+                m_queued.wait(&m_mutex);
+            if (m_queue.isEmpty())
+                return;
+            snapshot = m_queue.dequeue();
+        }
+
+        bool keyframe = written % keyframeInterval == 0;
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << qint32(snapshot.c) << snapshot.length << snapshot.convergence.branching
+               << snapshot.convergence.entropy << qint32(snapshot.convergence.idleCycles)
+               << qint32(snapshot.convergence.restarts);
+        if (keyframe || snapshot.trip != m_lastTrip) {
+            m_lastTrip = snapshot.trip;
+            stream << qint32(snapshot.trip.size());
+            for (int town : snapshot.trip)
+                stream << qint32(town);
+        }
+        else {
+            stream << qint32(0);
+        }
+
+        // the edges go as the gaps between them, which compress well
+        QVector<int> edges;
+        for (int e = 0; e < m_edges; e++) {
+            float trail = snapshot.trails[e];
+            if (keyframe || qAbs(trail - m_lastTrails[e]) > threshold * qAbs(m_lastTrails[e])) {
+                edges.append(e);
+                m_lastTrails[e] = trail;
+            }
+        }
+        stream << qint32(edges.size());
+        int previous = 0;
+        for (int e : edges) {
+            stream << qint32(e - previous);
+            previous = e;
+        }
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        for (int e : edges)
+            stream << m_lastTrails[e];
+
+        QByteArray compressed = qCompress(payload);
+        char prefix[1 + sizeof(quint32)];
+        prefix[0] = keyframe ? 1 : 0;
+        qToLittleEndian<quint32>(compressed.size(), reinterpret_cast<uchar*>(prefix + 1));
+        bool ok = append(prefix, sizeof(prefix)) && append(compressed.constData(), compressed.size());
+        if (ok)
+            written++;
+
+        QMutexLocker locker(&m_mutex);
+        if (ok)
+            m_frames++;
+        else
+            m_dropped++;
+        m_spare.append(snapshot.trails);
+    }
+}
+
+bool Recorder::append(const char *data, qint64 size) {
+    if (m_size + size > m_capacity) {
+        // the map grows by doubling, finish() cuts the file to what was written
+        qint64 capacity = qMax(qMax<qint64>(m_capacity * 2, 1 << 20), m_size + size);
+        if (m_map)
+            m_file.unmap(m_map);
+        m_map = nullptr;
+        if (m_file.resize(capacity))
+            m_map = m_file.map(0, capacity);
+        if (!m_map) {
+            m_error = m_file.errorString();
+            return false;
+        }
+        m_capacity = capacity;
+    }
+    memcpy(m_map + m_size, data, size);
+    m_size += size;
+    return true;
+}
+
+bool Recorder::readHeader(const uchar *data, qint64 size, Header &header) {
+    if (size < headerSize())
+        return false;
+    QDataStream stream(QByteArray::fromRawData(reinterpret_cast<const char*>(data), headerSize()));
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 fileMagic, fileVersion, towns, edges, interval;
+    quint8 sparse;
+    stream >> fileMagic >> fileVersion >> towns >> edges >> sparse >> interval;
+    if (fileMagic != magic || fileVersion != version)
+        return false;
+    header.towns = towns;
+    header.edges = edges;
+    header.sparse = sparse;
+    header.interval = interval;
+    return true;
+}
+
+bool Recorder::readFrame(const uchar *data, int size, const Header &header, Frame &frame) {
+    // nothing read from the file is trusted, qUncompress() would allocate whatever size the frame claims
+    const qint64 largest = 64 + 4 * qint64(header.towns) + 8 * qint64(header.edges);
+    if (size < 4 || qFromBigEndian<quint32>(data) > largest)
+        return false;
+    QByteArray payload = qUncompress(data, size);
+    if (payload.isEmpty())
+        return false;
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_0);
+    qint32 c, idleCycles, restarts, tripSize, edgeCount;
+    stream >> c >> frame.length >> frame.convergence.branching >> frame.convergence.entropy >> idleCycles >> restarts;
+    frame.c = c;
+    frame.convergence.idleCycles = idleCycles;
+    frame.convergence.restarts = restarts;
+
+    stream >> tripSize;
+    if (tripSize < 0 || tripSize > header.towns || 4 * qint64(tripSize) > stream.device()->bytesAvailable())
+        return false;
+    frame.trip.resize(tripSize);
+    for (int &town : frame.trip) {
+        qint32 t;
+        stream >> t;
+        if (t < 0 || t >= header.towns)
+            return false;
+        town = t;
+    }
+
+    stream >> edgeCount;
+    if (edgeCount < 0 || edgeCount > header.edges || 8 * qint64(edgeCount) > stream.device()->bytesAvailable())
+        return false;
+    frame.edges.resize(edgeCount);
+    qint64 previous = 0;
+    for (int &e : frame.edges) {
+        qint32 gap;
+        stream >> gap;
+        previous += gap;
+        if (gap < 0 || previous >= header.edges)
+            return false;
+        e = previous;
+    }
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    frame.trails.resize(frame.edges.size());
+    for (float &trail : frame.trails)
+        stream >> trail;
+    return stream.status() == QDataStream::Ok;
+}
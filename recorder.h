@@ -0,0 +1,140 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "colony.h"
+
+/**
+ * Records how a colony evolves into a file to be replayed later. Every
+ * interval cycles record() copies the trails, the shortest trip and the
+ * counters of the colony and hands them to a writer thread, so the colony
+ * only pays for the copy. When the writer falls behind the frame is
+ * dropped instead of waiting for it.
+ *
+ * The writer keeps only the trails that changed since the last frame, and
+ * every keyframeInterval frames all of them so a replay can jump anywhere.
+ * Frames are compressed and appended to the file through a memory map
+ * that grows as needed.
+ *
+ * The file starts with a header (magic, version, towns, edges, whether
+ * the instance is sparse, interval), then every frame is a flag byte
+ * (keyframe or not), the size of the frame and the compressed frame.
+ */
+class Recorder {
+public:
+    static const quint32 magic = 0x524f4341; // "ACOR"
+    static const quint32 version = 1;
+    static const int keyframeInterval = 32;
+    static const int maxQueued = 8;
+    // relative change of a trail that is worth recording
+    static constexpr float threshold = 1e-3f;
+
+    struct Header {
+        int towns { 0 };
+        int edges { 0 };
+        bool sparse { false };
+        int interval { 0 };
+    };
+
+    struct Frame {
+        int c { 0 };
+        qreal length { HUGE_VAL };
+        Convergence convergence { };
+        // empty when the shortest trip didn't change since the last frame
+        QVector<int> trip { };
+        // the edges whose trails changed and their new trails
+        QVector<int> edges { };
+        QVector<float> trails { };
+    };
+
+    Recorder(const QString &fileName, int interval = 10);
+    ~Recorder();
+
+    QString error() const;
+    int interval() const;
+    int frames() const;
+    int dropped() const;
+
+    bool open(const Instance *instance);
+    void record(const Colony &colony);
+    // waits for the queued frames and cuts the file to its size
+    void finish();
+
+    static bool readHeader(const uchar *data, qint64 size, Header &header);
+    // fails on anything that doesn't fit the header
+    static bool readFrame(const uchar *data, int size, const Header &header, Frame &frame);
+    static int headerSize();
+private:
+    // the state of the colony as record() copies it
+    struct Snapshot {
+        int c;
+        qreal length;
+        Convergence convergence;
+        QVector<int> trip;
+        QVector<qreal> trails;
+    };
+
+    void write();
+    bool append(const char *data, qint64 size);
+
+    QString m_error { };
+    int m_interval { 10 };
+    int m_edges { 0 };
+    QFile m_file;
+    bool m_open { false };
+    uchar *m_map { nullptr };
+    qint64 m_size { 0 };
+    qint64 m_capacity { 0 };
+
+    mutable QMutex m_mutex { };
+    QWaitCondition m_queued { };
+    QQueue<Snapshot> m_queue { };
+    // trail buffers the writer is done with, so record() doesn't allocate
+    QVector<QVector<qreal>> m_spare { };
+    bool m_finishing { false };
+    int m_frames { 0 };
+    int m_dropped { 0 };
+    QThreadPool m_pool { };
+    QFuture<void> m_writer { };
+
+    // owned by the writer
+    QVector<float> m_lastTrails { };
+    QVector<int> m_lastTrip { };
+};
+
+#endif // RECORDER_H
@@ -0,0 +1,199 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "replay.h"
+#include "aco.h"
+
+#include <QtEndian>
+
+#include <limits>
+
+Replay::Replay(Aco *parent)
+    : QObject(parent) {
+    connect(parent, &Canvas::topologyChanged, this, &Replay::close);
+}
+
+Replay::~Replay() {
+    close();
+}
+
+Aco *Replay::aco() {
+    return qobject_cast<Aco*>(parent());
+}
+
+int Replay::frameCount() {
+    return m_offsets.size();
+}
+
+int Replay::frame() {
+    return m_frame;
+}
+
+int Replay::c() {
+    return m_current.c;
+}
+
+qreal Replay::shortestTripLength() {
+    return m_current.length;
+}
+
+qreal Replay::branching() {
+    return m_current.convergence.branching;
+}
+
+qreal Replay::entropy() {
+    return m_current.convergence.entropy;
+}
+
+QString Replay::error() {
+    return m_error;
+}
+
+bool Replay::load(const QUrl &file) {
+    close();
+    m_file.setFileName(file.toLocalFile());
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(m_file.errorString());
+    qint64 size = m_file.size();
+    m_data = m_file.map(0, size);
+    if (!m_data)
+        return fail(m_file.errorString());
+    if (!Recorder::readHeader(m_data, size, m_header))
+        return fail("Not a recorded run");
+    if (m_header.towns != aco()->towns().size())
+        return fail("The run was recorded on another map");
+    if (!mapPaths())
+        return fail("The run was recorded on another map");
+
+    // a frame cut short by a crashed run is left out
+    qint64 pos = Recorder::headerSize();
+    while (pos + 1 + qint64(sizeof(quint32)) <= size) {
+        bool keyframe = m_data[pos];
+        qint64 frameSize = qFromLittleEndian<quint32>(m_data + pos + 1);
+        pos += 1 + sizeof(quint32);
+        if (pos + frameSize > size || frameSize > std::numeric_limits<int>::max())
+            break;
+        m_keyframes.append(keyframe || m_keyframes.isEmpty() ? m_offsets.size() : m_keyframes.last());
+        m_offsets.append(pos);
+        m_sizes.append(frameSize);
+        pos += frameSize;
+    }
+    m_trails = QVector<float>(m_header.edges, aco()->initialTau());
+    m_error.clear();
+    emit errorChanged();
+    emit frameCountChanged();
+    setFrame(0);
+    return !m_offsets.isEmpty();
+}
+
+void Replay::close() {
+    if (m_data)
+        m_file.unmap(m_data);
+    m_data = nullptr;
+    m_file.close();
+    m_offsets.clear();
+    m_sizes.clear();
+    m_keyframes.clear();
+    m_paths.clear();
+    m_trails.clear();
+    m_trip.clear();
+    m_current = Recorder::Frame();
+    m_frame = -1;
+    emit frameCountChanged();
+    emit frameChanged();
+}
+
+void Replay::setFrame(int frame) {
+    if (m_offsets.isEmpty())
+        return;
+    frame = qBound(0, frame, m_offsets.size() - 1);
+    if (frame == m_frame)
+        return;
+
+    int start = m_frame >= 0 && frame > m_frame && m_keyframes[frame] <= m_frame ? m_frame + 1 : m_keyframes[frame];
+    // a keyframe carries every trail and the shortest trip, if there was one yet
+    if (start == m_keyframes[frame])
+        m_trip.clear();
+    for (int i = start; i <= frame; i++) {
+        Recorder::Frame f;
+        if (!Recorder::readFrame(m_data + m_offsets[i], m_sizes[i], m_header, f)) {
+            fail("The recorded run is damaged");
+            break;
+        }
+        for (int j = 0; j < f.edges.size(); j++) {
+            if (f.edges[j] < m_trails.size())
+                m_trails[f.edges[j]] = f.trails[j];
+        }
+        if (!f.trip.isEmpty())
+            m_trip = f.trip;
+        m_current = f;
+    }
+    m_frame = frame;
+
+    for (int e = 0; e < m_paths.size(); e++) {
+        if (m_paths[e])
+            m_paths[e]->setTrail(m_trails[e]);
+    }
+    if (m_trip.isEmpty())
+        aco()->algorithm()->clearShortestTrip();
+    else
+        aco()->algorithm()->setShortestTrip(m_trip, m_current.length);
+    emit frameChanged();
+}
+
+bool Replay::fail(const QString &error) {
+    m_error = error;
+    emit errorChanged();
+    return false;
+}
+
+bool Replay::mapPaths() {
+    // the edges are numbered as in the instance the run was recorded on
+    const int n = m_header.towns;
+    Instance instance;
+    if (m_header.sparse) {
+        instance = Instance::fromCanvas(aco());
+        if (!instance.sparse() || instance.edgeCount() != m_header.edges)
+            return false;
+    }
+    else if (m_header.edges != n * n) {
+        return false;
+    }
+    m_paths = QVector<Path*>(m_header.edges, nullptr);
+    for (Path *p : aco()->paths()) {
+        int a = aco()->indexOf(p->townA());
+        int b = aco()->indexOf(p->townB());
+        if (a < 0 || b < 0)
+            continue;
+        int forward = m_header.sparse ? instance.edge(a, b) : a * n + b;
+        int backward = m_header.sparse ? instance.edge(b, a) : b * n + a;
+        if (forward >= 0)
+            m_paths[forward] = p;
+        if (!aco()->directed() && backward >= 0)
+            m_paths[backward] = p;
+    }
+    return true;
+}
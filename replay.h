@@ -0,0 +1,101 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <QFile>
+#include <QObject>
+#include <QUrl>
+#include <QVector>
+
+#include "recorder.h"
+
+class Aco;
+class Path;
+
+/**
+ * Plays a file written by Recorder back on the canvas. The frames are
+ * only indexed when the file is loaded, moving to a frame applies the
+ * changes since the keyframe before it, or since the current frame when
+ * moving forward. The trails of the paths and the shortest trip of the
+ * algorithm then show the state of the recorded run.
+ *
+ * The run has to be recorded on the map that is loaded in the canvas.
+ */
+class Replay : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(int frameCount READ frameCount NOTIFY frameCountChanged)
+    Q_PROPERTY(int frame READ frame WRITE setFrame NOTIFY frameChanged)
+    Q_PROPERTY(int c READ c NOTIFY frameChanged)
+    Q_PROPERTY(qreal shortestTripLength READ shortestTripLength NOTIFY frameChanged)
+    Q_PROPERTY(qreal branching READ branching NOTIFY frameChanged)
+    Q_PROPERTY(qreal entropy READ entropy NOTIFY frameChanged)
+    Q_PROPERTY(QString error READ error NOTIFY errorChanged)
+public:
+    Replay(Aco *parent);
+    ~Replay();
+
+    Aco *aco();
+
+    int frameCount();
+    int frame();
+    int c();
+    qreal shortestTripLength();
+    qreal branching();
+    qreal entropy();
+    QString error();
+
+    Q_INVOKABLE bool load(const QUrl &file);
+public slots:
+    void close();
+    void setFrame(int frame);
+signals:
+    void frameCountChanged();
+    void frameChanged();
+    void errorChanged();
+private:
+    bool fail(const QString &error);
+    bool mapPaths();
+
+    QFile m_file { };
+    uchar *m_data { nullptr };
+    Recorder::Header m_header { };
+    // where every frame starts, how big it is and the keyframe it builds on
+    QVector<qint64> m_offsets { };
+    QVector<int> m_sizes { };
+    QVector<int> m_keyframes { };
+    // the path of every recorded edge, null for the ones missing on the canvas
+    QVector<Path*> m_paths { };
+
+    int m_frame { -1 };
+    Recorder::Frame m_current { };
+    QVector<float> m_trails { };
+    QVector<int> m_trip { };
+    QString m_error { };
+};
+
+#endif // REPLAY_H
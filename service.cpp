@@ -0,0 +1,639 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "service.h"
+#include "spatialgrid.h"
+#include "tsplib.h"
+
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QRunnable>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QtConcurrent>
+
+#include <cmath>
+#include <random>
+
+static const char *stateNames[] = { "queued", "running", "finished" };
+static const char *stopReasonNames[] = { "deadline", "stagnation", "cancelled", "cycles", "converged" };
+
+/**
+ * Runs one colony of a job on a thread of the pool. The last one to
+ * finish marks the job as finished.
+ */
+class JobRunner : public QRunnable {
+public:
+    JobRunner(Service *service, const QSharedPointer<Service::Job> &job, int index)
+        : m_service(service), m_job(job), m_index(index) {
+    }
+
+    void run() override {
+        Service::Job &job = *m_job;
+        Solver solver(job.parameters, job.seed + m_index);
+        solver.setStagnationLimit(job.stagnationLimit);
+        solver.setMaxCycles(job.maxCycles);
+        solver.setConvergenceLimit(job.convergenceLimit);
+        if (job.deterministic) {
+            solver.setThreads(job.threads, m_service->pool());
+            solver.setDeterministic(true);
+        }
+
+        qint64 timeout = -1;
+        Solver::Result result;
+        job.mutex.lock();
+        // the budget started when the job was queued, it may already be gone
+        bool skip = job.cancelled || (job.timeout >= 0 && job.timer.elapsed() >= job.timeout);
+        if (!skip) {
+            job.state = Service::Running;
+            job.solvers.append(&solver);
+            if (job.timeout >= 0)
+                timeout = job.timeout - job.timer.elapsed();
+        }
+        job.mutex.unlock();
+
+        if (!skip) {
+            result = solver.solve(job.instance, timeout, [this, &job](const Solver::Result &improvement) {
+                QMutexLocker locker(&job.mutex);
+                if (improvement.length >= job.result.length)
+                    return;
+                job.result.trip = improvement.trip;
+                job.result.length = improvement.length;
+                job.result.c = improvement.c;
+                job.result.convergence = improvement.convergence;
+                job.result.elapsed = job.timer.elapsed();
+                locker.unlock();
+                QMetaObject::invokeMethod(m_service, "jobImproved", Qt::QueuedConnection, Q_ARG(int, job.id));
+            });
+        }
+
+        job.mutex.lock();
+        job.solvers.removeOne(&solver);
+        job.cycles += result.c;
+        job.result.stopReason = job.cancelled ? Solver::Cancelled : result.stopReason;
+        if (!skip)
+            job.result.convergence = result.convergence;
+        bool finished = --job.running == 0;
+        if (finished) {
+            job.state = Service::Finished;
+            job.result.elapsed = job.timer.elapsed();
+        }
+        job.mutex.unlock();
+        if (finished)
+            QMetaObject::invokeMethod(m_service, "jobFinished", Qt::QueuedConnection, Q_ARG(int, job.id));
+    }
+private:
+    Service *m_service { nullptr };
+    QSharedPointer<Service::Job> m_job { };
+    int m_index { 0 };
+};
+
+// options of a TSPLIB request come in the query string
+static QJsonObject queryOptions(const QUrl &url) {
+    QJsonObject options;
+    for (const QPair<QString, QString> &item : QUrlQuery(url).queryItems()) {
+        bool ok = false;
+        double value = item.second.toDouble(&ok);
+        if (ok)
+            options.insert(item.first, value);
+        else
+            options.insert(item.first, item.second == "true" || item.second.isEmpty());
+    }
+    return options;
+}
+
+static bool instanceFromTowns(const QJsonArray &towns, Instance &instance, QString &error) {
+    const int n = towns.size();
+    if (n > Service::maxTowns) {
+        error = QString("At most %1 towns are allowed").arg(Service::maxTowns);
+        return false;
+    }
+    QVector<qreal> x(n), y(n);
+    for (int i = 0; i < n; i++) {
+        QJsonValue town = towns[i];
+        if (town.isArray() && town.toArray().size() == 2) {
+            x[i] = town.toArray()[0].toDouble();
+            y[i] = town.toArray()[1].toDouble();
+        }
+        else if (town.isObject()) {
+            x[i] = town.toObject().value("x").toDouble();
+            y[i] = town.toObject().value("y").toDouble();
+        }
+        else {
+            error = QString("Town %1 is neither [x, y] nor {\"x\": x, \"y\": y}").arg(i);
+            return false;
+        }
+        if (!std::isfinite(x[i]) || !std::isfinite(y[i])) {
+            error = QString("Town %1 has no finite coordinates").arg(i);
+            return false;
+        }
+    }
+
+    instance = Instance(n);
+    for (int i = 0; i < n; i++) {
+        qreal *row = instance.row(i);
+        for (int j = 0; j < n; j++) {
+            if (i != j)
+                row[j] = sqrt((x[i] - x[j]) * (x[i] - x[j]) + (y[i] - y[j]) * (y[i] - y[j]));
+        }
+    }
+
+    // the closest towns are the ones with the shortest paths, no need to sort the rows
+    SpatialGrid<int> grid(SpatialGrid<int>::cellSizeFor(x, y, n));
+    for (int i = 0; i < n; i++)
+        grid.insert(i, x[i], y[i]);
+    int k = qMin(Instance::defaultNeighbourCount, n - 1);
+    QVector<int> neighbours(n * k, -1);
+    for (int i = 0; i < n; i++) {
+        QVector<int> nearest = grid.nearest(x[i], y[i], k, [i](int other) {
+            return other == i;
+        });
+        std::copy(nearest.begin(), nearest.end(), neighbours.begin() + i * k);
+    }
+    instance.setNeighbours(k, neighbours);
+    return true;
+}
+
+static bool instanceFromDistances(const QJsonArray &distances, Instance &instance, QString &error) {
+    const int n = distances.size();
+    if (n > Service::maxTowns) {
+        error = QString("At most %1 towns are allowed").arg(Service::maxTowns);
+        return false;
+    }
+    instance = Instance(n);
+    bool symmetric = true;
+    for (int i = 0; i < n; i++) {
+        QJsonArray row = distances[i].toArray();
+        if (row.size() != n) {
+            error = QString("Row %1 of the distances has %2 entries instead of %3").arg(i).arg(row.size()).arg(n);
+            return false;
+        }
+        for (int j = 0; j < n; j++) {
+            // missing paths are null or negative
+            qreal distance = row[j].toDouble(-1.0);
+            if (i != j && distance >= 0.0)
+                instance.setDistance(i, j, distance);
+        }
+    }
+    for (int i = 0; i < n && symmetric; i++) {
+        for (int j = i + 1; j < n && symmetric; j++)
+            symmetric = instance.distance(i, j) == instance.distance(j, i);
+    }
+    instance.setSymmetric(symmetric);
+    instance.buildNeighbours(Instance::defaultNeighbourCount);
+    return true;
+}
+
+Service::Service(QObject *parent)
+    : QObject(parent), m_server(new QTcpServer(this)) {
+    m_maxThreadsPerJob = m_pool.maxThreadCount();
+    connect(m_server, &QTcpServer::newConnection, this, &Service::acceptConnection);
+}
+
+Service::~Service() {
+    for (const QSharedPointer<Job> &job : m_jobs) {
+        QMutexLocker locker(&job->mutex);
+        job->cancelled = true;
+        for (Solver *solver : job->solvers)
+            solver->cancel();
+    }
+    for (const QSharedPointer<Batch> &batch : m_batches)
+        batch->cancel();
+    m_pool.waitForDone();
+}
+
+bool Service::listen(quint16 port) {
+    return m_server->listen(QHostAddress::LocalHost, port);
+}
+
+quint16 Service::port() {
+    return m_server->serverPort();
+}
+
+QThreadPool *Service::pool() {
+    return &m_pool;
+}
+
+int Service::maxThreadsPerJob() {
+    return m_maxThreadsPerJob;
+}
+
+void Service::setMaxThreadsPerJob(int threads) {
+    m_maxThreadsPerJob = qMax(1, threads);
+}
+
+void Service::acceptConnection() {
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, &Service::readRequest);
+        connect(socket, &QTcpSocket::disconnected, this, &Service::dropConnection);
+    }
+}
+
+void Service::readRequest() {
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || !m_buffers.contains(socket))
+        return;
+    QByteArray &buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (buffer.size() > maxHeaderSize) {
+            m_buffers.remove(socket);
+            reply(socket, 431, QJsonObject { { "error", "Request header is too large" } });
+        }
+        return;
+    }
+
+    QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3) {
+        m_buffers.remove(socket);
+        reply(socket, 400, QJsonObject { { "error", "Malformed request line" } });
+        return;
+    }
+    qint64 contentLength = 0;
+    bool expectContinue = false;
+    for (int i = 1; i < lines.size(); i++) {
+        QByteArray name = lines[i].left(lines[i].indexOf(':')).trimmed().toLower();
+        QByteArray value = lines[i].mid(lines[i].indexOf(':') + 1).trimmed();
+        if (name == "content-length")
+            contentLength = value.toLongLong();
+        else if (name == "expect" && value.toLower() == "100-continue")
+            expectContinue = true;
+    }
+    if (contentLength < 0 || contentLength > maxBodySize) {
+        m_buffers.remove(socket);
+        reply(socket, 413, QJsonObject { { "error", "Request body is too large" } });
+        return;
+    }
+    if (buffer.size() < headerEnd + 4 + contentLength) {
+        if (expectContinue && !socket->property("continued").toBool()) {
+            socket->setProperty("continued", true);
+            socket->write("HTTP/1.1 100 Continue\r\n\r\n");
+        }
+        return;
+    }
+
+    QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+    m_buffers.remove(socket);
+    handle(socket, requestLine[0], QUrl(QString::fromLatin1(requestLine[1])), body);
+}
+
+void Service::dropConnection() {
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket)
+        return;
+    m_buffers.remove(socket);
+    if (m_batches.contains(socket))
+        m_batches.take(socket)->cancel();
+    // nobody is going to read the result of a solve request that lost its client
+    for (auto it = m_waiting.begin(); it != m_waiting.end(); ++it) {
+        if (it.value() == socket) {
+            QSharedPointer<Job> job = m_jobs.value(it.key());
+            if (job) {
+                QMutexLocker locker(&job->mutex);
+                job->cancelled = true;
+                for (Solver *solver : job->solvers)
+                    solver->cancel();
+            }
+            m_streaming.remove(it.key());
+            m_waiting.erase(it);
+            break;
+        }
+    }
+    socket->deleteLater();
+}
+
+void Service::handle(QTcpSocket *socket, const QByteArray &method, const QUrl &url, const QByteArray &body) {
+    QString path = url.path();
+    if (path == "/solve" || path == "/jobs") {
+        if (method != "POST") {
+            reply(socket, 405, QJsonObject { { "error", "Use POST" } });
+            return;
+        }
+        QJsonObject request;
+        QByteArray tsplib;
+        if (body.trimmed().startsWith('{')) {
+            QJsonParseError parseError;
+            QJsonDocument document = QJsonDocument::fromJson(body, &parseError);
+            if (!document.isObject()) {
+                reply(socket, 400, QJsonObject { { "error", parseError.errorString() } });
+                return;
+            }
+            request = document.object();
+        }
+        else {
+            request = queryOptions(url);
+            tsplib = body;
+        }
+
+        QString error;
+        QSharedPointer<Job> job = createJob(request, tsplib, error);
+        if (!job) {
+            reply(socket, 400, QJsonObject { { "error", error } });
+            return;
+        }
+        if (path == "/jobs") {
+            reply(socket, 202, QJsonObject { { "id", job->id } });
+        }
+        else {
+            m_waiting.insert(job->id, socket);
+            if (request.value("stream").toBool()) {
+                m_streaming.insert(job->id, true);
+                socket->write("HTTP/1.1 200 OK\r\n"
+                              "Content-Type: application/x-ndjson\r\n"
+                              "Transfer-Encoding: chunked\r\n"
+                              "Connection: close\r\n\r\n");
+            }
+        }
+        startJob(job);
+        return;
+    }
+
+    if (path == "/batch") {
+        if (method != "POST") {
+            reply(socket, 405, QJsonObject { { "error", "Use POST" } });
+            return;
+        }
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(body, &parseError);
+        if (!document.isObject()) {
+            reply(socket, 400, QJsonObject { { "error", parseError.errorString() } });
+            return;
+        }
+        QString error;
+        QSharedPointer<Batch> batch = createBatch(document.object(), error);
+        if (!batch) {
+            reply(socket, 400, QJsonObject { { "error", error } });
+            return;
+        }
+        startBatch(socket, batch, qBound(1, document.object().value("threads").toInt(m_maxThreadsPerJob), m_maxThreadsPerJob));
+        return;
+    }
+
+    if (path.startsWith("/jobs/")) {
+        bool ok = false;
+        int id = path.mid(6).toInt(&ok);
+        QSharedPointer<Job> job = m_jobs.value(id);
+        if (!ok || !job) {
+            reply(socket, 404, QJsonObject { { "error", "No such job" } });
+        }
+        else if (method == "GET") {
+            reply(socket, 200, status(job));
+        }
+        else if (method == "DELETE") {
+            job->mutex.lock();
+            job->cancelled = true;
+            for (Solver *solver : job->solvers)
+                solver->cancel();
+            job->mutex.unlock();
+            reply(socket, 200, status(job));
+        }
+        else {
+            reply(socket, 405, QJsonObject { { "error", "Use GET or DELETE" } });
+        }
+        return;
+    }
+
+    reply(socket, 404, QJsonObject { { "error", "Unknown resource" } });
+}
+
+// the parameters come from the keys of the request itself, a single huge colony would exhaust the memory
+static bool parametersFromRequest(const QJsonObject &request, Parameters &parameters, QString &error) {
+    parameters = Parameters::fromJson(request);
+    if (request.value("antCount").toDouble(parameters.antCount) > Service::maxAntCount) {
+        error = QString("At most %1 ants are allowed").arg(Service::maxAntCount);
+        return false;
+    }
+    return true;
+}
+
+// an instance is given by the coordinates of its towns, a distance matrix or a TSPLIB file
+static bool instanceFromRequest(const QJsonObject &request, const QByteArray &tsplib, Instance &instance, QString &error) {
+    if (!tsplib.isEmpty() || request.contains("tsplib")) {
+        Tsplib parsed;
+        if (!Tsplib::parse(tsplib.isEmpty() ? request.value("tsplib").toString().toUtf8() : tsplib, parsed, true, Service::maxTowns)) {
+            error = parsed.error.isEmpty() ? QString("Not a TSPLIB instance") : parsed.error;
+            return false;
+        }
+        instance = parsed.instance;
+        instance.buildNeighbours(Instance::defaultNeighbourCount);
+    }
+    else if (request.value("towns").isArray()) {
+        if (!instanceFromTowns(request.value("towns").toArray(), instance, error))
+            return false;
+    }
+    else if (request.value("distances").isArray()) {
+        if (!instanceFromDistances(request.value("distances").toArray(), instance, error))
+            return false;
+    }
+    else {
+        error = "The request has neither towns, distances nor a TSPLIB instance";
+        return false;
+    }
+    if (instance.size() < 2) {
+        error = "An instance needs at least two towns";
+        return false;
+    }
+    return true;
+}
+
+static QJsonObject resultToJson(const Solver::Result &result) {
+    QJsonObject json {
+        { "c", result.c },
+        { "elapsed", result.elapsed },
+        { "branching", result.convergence.branching },
+        { "entropy", result.convergence.entropy },
+        { "idleCycles", result.convergence.idleCycles },
+        { "restarts", result.convergence.restarts },
+    };
+    if (result.length != HUGE_VAL) {
+        QJsonArray trip;
+        for (int town : result.trip)
+            trip.append(town);
+        json.insert("length", result.length);
+        json.insert("trip", trip);
+    }
+    else {
+        json.insert("length", QJsonValue());
+    }
+    return json;
+}
+
+QSharedPointer<Service::Job> Service::createJob(const QJsonObject &request, const QByteArray &tsplib, QString &error) {
+    QSharedPointer<Job> job(new Job());
+    job->timer.start();
+    if (!instanceFromRequest(request, tsplib, job->instance, error))
+        return QSharedPointer<Job>();
+    if (!parametersFromRequest(request, job->parameters, error))
+        return QSharedPointer<Job>();
+
+    job->timeout = (qint64) request.value("time").toDouble(job->timeout);
+    job->stagnationLimit = qMax(0, request.value("stagnation").toInt(0));
+    job->maxCycles = qMax(0, request.value("cycles").toInt(0));
+    job->convergenceLimit = qMax(0.0, request.value("converged").toDouble(0.0));
+    if (job->timeout < 0 && job->stagnationLimit == 0 && job->maxCycles == 0) {
+        error = "A job without a time budget needs a stagnation or cycle limit";
+        return QSharedPointer<Job>();
+    }
+    job->threads = qBound(1, request.value("threads").toInt(1), m_maxThreadsPerJob);
+    job->deterministic = request.value("deterministic").toBool(false);
+    job->seed = request.contains("seed") ? (quint32) request.value("seed").toDouble() : std::random_device()();
+
+    job->id = ++m_lastId;
+    m_jobs.insert(job->id, job);
+    return job;
+}
+
+QSharedPointer<Batch> Service::createBatch(const QJsonObject &request, QString &error) {
+    Parameters parameters;
+    if (!parametersFromRequest(request, parameters, error))
+        return QSharedPointer<Batch>();
+    QSharedPointer<Batch> batch(new Batch(parameters,
+                                          request.contains("seed") ? (quint32) request.value("seed").toDouble() : std::random_device()()));
+    QJsonArray instances = request.value("instances").toArray();
+    if (instances.isEmpty()) {
+        error = "The batch has no instances";
+        return QSharedPointer<Batch>();
+    }
+    for (int i = 0; i < instances.size(); i++) {
+        Instance instance;
+        if (!instanceFromRequest(instances[i].toObject(), QByteArray(), instance, error)) {
+            error = QString("Instance %1: %2").arg(i).arg(error);
+            return QSharedPointer<Batch>();
+        }
+        batch->add(instance);
+    }
+
+    // a batch has to finish, by default every instance gets a hundred cycles
+    batch->setTimeout((qint64) request.value("time").toDouble(-1));
+    batch->setStagnationLimit(request.value("stagnation").toInt(0));
+    batch->setMaxCycles(request.value("cycles").toInt(batch->timeout() < 0 && batch->stagnationLimit() == 0 ? 100 : 0));
+    if (batch->timeout() < 0 && batch->stagnationLimit() == 0 && batch->maxCycles() == 0) {
+        error = "A batch without a time budget needs a stagnation or cycle limit";
+        return QSharedPointer<Batch>();
+    }
+    return batch;
+}
+
+void Service::startJob(const QSharedPointer<Job> &job) {
+    job->running = job->deterministic ? 1 : job->threads;
+    for (int i = 0; i < job->running; i++)
+        m_pool.start(new JobRunner(this, job, i));
+}
+
+QJsonObject Service::status(const QSharedPointer<Job> &job) {
+    QMutexLocker locker(&job->mutex);
+    QJsonObject status = resultToJson(job->result);
+    status.insert("id", job->id);
+    status.insert("state", stateNames[job->state]);
+    status.insert("cycles", job->cycles);
+    if (job->state == Finished)
+        status.insert("stopReason", stopReasonNames[job->result.stopReason]);
+    return status;
+}
+
+void Service::startBatch(QTcpSocket *socket, const QSharedPointer<Batch> &batch, int threads) {
+    m_batches.insert(socket, batch);
+    QFutureWatcher<QVector<Solver::Result>> *watcher = new QFutureWatcher<QVector<Solver::Result>>(this);
+    QPointer<QTcpSocket> client(socket);
+    connect(watcher, &QFutureWatcher<QVector<Solver::Result>>::finished, this, [this, watcher, client]() {
+        watcher->deleteLater();
+        if (!client || !m_batches.contains(client))
+            return;
+        m_batches.remove(client);
+        QJsonArray results;
+        for (const Solver::Result &result : watcher->result()) {
+            QJsonObject json = resultToJson(result);
+            json.insert("stopReason", stopReasonNames[result.stopReason]);
+            results.append(json);
+        }
+        reply(client, 200, QJsonObject { { "results", results } });
+    });
+    QThreadPool *pool = &m_pool;
+    watcher->setFuture(QtConcurrent::run(pool, [batch, threads, pool]() {
+        return batch->solve(threads, pool);
+    }));
+}
+
+void Service::jobImproved(int id) {
+    QTcpSocket *socket = m_waiting.value(id);
+    if (socket && m_streaming.contains(id))
+        writeChunk(socket, QJsonDocument(status(m_jobs.value(id))).toJson(QJsonDocument::Compact) + "\n");
+}
+
+void Service::jobFinished(int id) {
+    m_finished.append(id);
+    while (m_finished.size() > maxFinishedJobs)
+        m_jobs.remove(m_finished.takeFirst());
+
+    QTcpSocket *socket = m_waiting.take(id);
+    QSharedPointer<Job> job = m_jobs.value(id);
+    if (!socket || !job)
+        return;
+    if (m_streaming.take(id)) {
+        writeChunk(socket, QJsonDocument(status(job)).toJson(QJsonDocument::Compact) + "\n");
+        socket->write("0\r\n\r\n");
+        socket->disconnectFromHost();
+    }
+    else {
+        reply(socket, 200, status(job));
+    }
+}
+
+void Service::reply(QTcpSocket *socket, int code, const QJsonObject &body) {
+    static const QHash<int, QByteArray> reasons {
+        { 200, "OK" },
+        { 202, "Accepted" },
+        { 400, "Bad Request" },
+        { 404, "Not Found" },
+        { 405, "Method Not Allowed" },
+        { 413, "Payload Too Large" },
+        { 431, "Request Header Fields Too Large" },
+    };
+    QByteArray data = QJsonDocument(body).toJson(QJsonDocument::Compact) + "\n";
+    socket->write("HTTP/1.1 " + QByteArray::number(code) + " " + reasons.value(code) + "\r\n"
+                  "Content-Type: application/json\r\n"
+                  "Content-Length: " + QByteArray::number(data.size()) + "\r\n"
+                  "Connection: close\r\n\r\n");
+    socket->write(data);
+    socket->disconnectFromHost();
+}
+
+void Service::writeChunk(QTcpSocket *socket, const QByteArray &data) {
+    socket->write(QByteArray::number(data.size(), 16) + "\r\n");
+    socket->write(data);
+    socket->write("\r\n");
+}
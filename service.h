@@ -0,0 +1,141 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+#include "batch.h"
+#include "colony.h"
+#include "solver.h"
+
+class QTcpServer;
+class QTcpSocket;
+class QUrl;
+
+/**
+ * Solving as a service: a small HTTP server on localhost that takes
+ * instances as JSON or TSPLIB and solves them on a shared thread pool.
+ *
+ *   POST /solve        solves and replies with the result, with "stream"
+ *                      set every improvement is sent as a line of JSON
+ *   POST /jobs         queues the instance and replies with the job id
+ *   GET /jobs/<id>     state and shortest trip of a job so far
+ *   DELETE /jobs/<id>  cancels a job
+ *   POST /batch        solves a list of instances with the same settings
+ *                      and replies with their results in the same order
+ *
+ * A job runs one colony per thread, up to maxThreadsPerJob of them, so
+ * many small jobs don't wait for each other while a big one can still
+ * use more cores. The time budget starts when the job is queued.
+ */
+class Service : public QObject {
+    Q_OBJECT
+public:
+    static const int maxFinishedJobs = 1000;
+    static const int maxHeaderSize = 64 * 1024;
+    static const int maxBodySize = 256 * 1024 * 1024;
+    static const int maxAntCount = 10000;
+    static const int maxTowns = 5000;
+
+    enum States {
+        Queued = 0,
+        Running,
+        Finished,
+    };
+
+    struct Job {
+        int id { 0 };
+        Instance instance { };
+        Parameters parameters { };
+        qint64 timeout { 1000 };
+        int stagnationLimit { 0 };
+        int maxCycles { 0 };
+        qreal convergenceLimit { 0.0 };
+        int threads { 1 };
+        // a single colony whose ants use the threads, the same seed then gives the same trip
+        bool deterministic { false };
+        quint32 seed { 0 };
+        QElapsedTimer timer { };
+
+        // guarded by mutex, the solvers work on their own copy
+        QMutex mutex { };
+        int state { Queued };
+        int running { 0 };
+        bool cancelled { false };
+        QList<Solver*> solvers { };
+        Solver::Result result { };
+        int cycles { 0 };
+    };
+
+    Service(QObject *parent = nullptr);
+    ~Service();
+
+    bool listen(quint16 port);
+    quint16 port();
+    QThreadPool *pool();
+    int maxThreadsPerJob();
+    void setMaxThreadsPerJob(int threads);
+private slots:
+    void acceptConnection();
+    void readRequest();
+    void dropConnection();
+    void jobImproved(int id);
+    void jobFinished(int id);
+private:
+    void handle(QTcpSocket *socket, const QByteArray &method, const QUrl &url, const QByteArray &body);
+    QSharedPointer<Job> createJob(const QJsonObject &request, const QByteArray &tsplib, QString &error);
+    void startJob(const QSharedPointer<Job> &job);
+    QSharedPointer<Batch> createBatch(const QJsonObject &request, QString &error);
+    void startBatch(QTcpSocket *socket, const QSharedPointer<Batch> &batch, int threads);
+    QJsonObject status(const QSharedPointer<Job> &job);
+    void reply(QTcpSocket *socket, int code, const QJsonObject &body);
+    void writeChunk(QTcpSocket *socket, const QByteArray &data);
+
+    QTcpServer *m_server { nullptr };
+    QThreadPool m_pool { };
+    int m_maxThreadsPerJob { 1 };
+    int m_lastId { 0 };
+
+    QHash<QTcpSocket*, QByteArray> m_buffers { };
+    QHash<int, QSharedPointer<Job>> m_jobs { };
+    QList<int> m_finished { };
+    // clients of POST /solve waiting for their job, the streaming ones get every improvement
+    QHash<int, QTcpSocket*> m_waiting { };
+    QHash<int, bool> m_streaming { };
+    QHash<QTcpSocket*, QSharedPointer<Batch>> m_batches { };
+};
+
+#endif // SERVICE_H
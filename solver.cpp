@@ -0,0 +1,145 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "solver.h"
+
+#include <QElapsedTimer>
+
+Solver::Solver(const Parameters &parameters, quint32 seed)
+    : m_parameters(parameters), m_seed(seed) {
+}
+
+const Parameters &Solver::parameters() const {
+    return m_parameters;
+}
+
+int Solver::stagnationLimit() const {
+    return m_stagnationLimit;
+}
+
+int Solver::maxCycles() const {
+    return m_maxCycles;
+}
+
+qreal Solver::convergenceLimit() const {
+    return m_convergenceLimit;
+}
+
+void Solver::setConvergenceLimit(qreal limit) {
+    m_convergenceLimit = qMax(0.0, limit);
+}
+
+void Solver::setStagnationLimit(int cycles) {
+    m_stagnationLimit = qMax(0, cycles);
+}
+
+void Solver::setMaxCycles(int cycles) {
+    m_maxCycles = qMax(0, cycles);
+}
+
+void Solver::setArena(Arena *arena) {
+    m_arena = arena;
+}
+
+void Solver::setRecorder(Recorder *recorder) {
+    m_recorder = recorder;
+}
+
+void Solver::setThreads(int threads, QThreadPool *pool) {
+    m_threads = qMax(1, threads);
+    m_pool = pool;
+}
+
+void Solver::setDeterministic(bool deterministic) {
+    m_deterministic = deterministic;
+}
+
+Solver::Result Solver::solve(const Instance &instance, qint64 timeout, const Callback &callback) {
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    // a colony on fewer than two towns doesn't count its cycles, no limit but the deadline would ever stop it
+    if (instance.size() < 2) {
+        m_cancelled.store(0);
+        return result;
+    }
+    Colony colony(&instance, m_parameters, m_seed, m_arena);
+    colony.setThreads(m_threads, m_pool);
+    colony.setDeterministic(m_deterministic);
+    int lastImprovement = 0;
+    qint64 slowestCycle = 0;
+    while (true) {
+        if (m_cancelled.load()) {
+            result.stopReason = Cancelled;
+            break;
+        }
+        if (m_maxCycles > 0 && colony.c() >= m_maxCycles) {
+            result.stopReason = Cycles;
+            break;
+        }
+        if (m_stagnationLimit > 0 && colony.c() - lastImprovement >= m_stagnationLimit) {
+            result.stopReason = Stagnation;
+            break;
+        }
+        if (m_convergenceLimit > 0.0 && colony.convergence().settled && colony.convergence().branching <= m_convergenceLimit) {
+            result.stopReason = Converged;
+            break;
+        }
+        // don't start a cycle that would most likely end after the deadline
+        if (timeout >= 0 && timer.elapsed() + slowestCycle > timeout) {
+            result.stopReason = Deadline;
+            break;
+        }
+
+        qint64 cycleStart = timer.elapsed();
+        colony.cycle();
+        if (m_recorder)
+            m_recorder->record(colony);
+        slowestCycle = qMax(slowestCycle, timer.elapsed() - cycleStart);
+
+        if (colony.shortestTripLength() < result.length) {
+            lastImprovement = colony.c();
+            result.trip = colony.shortestTrip();
+            result.length = colony.shortestTripLength();
+            result.c = colony.c();
+            result.elapsed = timer.elapsed();
+            result.convergence = colony.convergence();
+            if (callback)
+                callback(result);
+        }
+    }
+    m_cancelled.store(0);
+
+    result.c = colony.c();
+    result.elapsed = timer.elapsed();
+    result.convergence = colony.convergence();
+    return result;
+}
+
+void Solver::cancel() {
+    m_cancelled.store(1);
+}
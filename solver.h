@@ -0,0 +1,104 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <QAtomicInt>
+#include <QVector>
+
+#include <functional>
+
+#include "colony.h"
+#include "recorder.h"
+
+/**
+ * Anytime solver: runs cycles of a colony until a time budget runs out,
+ * the colony stops improving or converges, or somebody cancels it. The shortest trip
+ * found so far is reported through a callback every time it improves, so
+ * the caller always has a usable answer no matter when it has to stop.
+ *
+ * solve() blocks, the callback is called from the thread running it and
+ * cancel() may be called from any thread.
+ */
+class Solver {
+public:
+    enum StopReasons {
+        Deadline = 0,
+        Stagnation,
+        Cancelled,
+        Cycles,
+        Converged,
+    };
+
+    struct Result {
+        QVector<int> trip { };
+        qreal length { HUGE_VAL };
+        int c { 0 };
+        qint64 elapsed { 0 };
+        int stopReason { Deadline };
+        Convergence convergence { };
+    };
+
+    typedef std::function<void(const Result &result)> Callback;
+
+    Solver(const Parameters &parameters = Parameters(), quint32 seed = 0);
+
+    const Parameters &parameters() const;
+    int stagnationLimit() const;
+    int maxCycles() const;
+    qreal convergenceLimit() const;
+    void setStagnationLimit(int cycles);
+    void setMaxCycles(int cycles);
+    // stops once the branching factor drops to limit, unless the colony restarts before
+    void setConvergenceLimit(qreal limit);
+    // the colony takes its memory from arena instead of allocating its own
+    void setArena(Arena *arena);
+    // every cycle is offered to recorder, which has to be open already
+    void setRecorder(Recorder *recorder);
+    // the ants of the colony build their trips in threads of pool, see Colony
+    void setThreads(int threads, QThreadPool *pool = nullptr);
+    // the same seed gives the same run with any number of threads, as long as no time budget stops it
+    void setDeterministic(bool deterministic);
+
+    // timeout in milliseconds, a negative one never expires
+    Result solve(const Instance &instance, qint64 timeout, const Callback &callback = Callback());
+    void cancel();
+private:
+    Parameters m_parameters { };
+    quint32 m_seed { 0 };
+    int m_stagnationLimit { 0 };
+    int m_maxCycles { 0 };
+    qreal m_convergenceLimit { 0.0 };
+    Arena *m_arena { nullptr };
+    Recorder *m_recorder { nullptr };
+    int m_threads { 1 };
+    QThreadPool *m_pool { nullptr };
+    bool m_deterministic { false };
+    QAtomicInt m_cancelled { 0 };
+};
+
+#endif // SOLVER_H
@@ -0,0 +1,229 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <QHash>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+#include <vector>
+
+/**
+ * Uniform grid over points in the plane. Every item is kept in the cell
+ * its point falls into, so moving an item or looking at the items around
+ * a point only touches a few cells. Each item also remembers the order it
+ * was inserted in, hit tests use it to prefer the newest item.
+ */
+template<typename T>
+class SpatialGrid {
+public:
+    struct Entry {
+        T item;
+        qreal x;
+        qreal y;
+        quint64 order;
+    };
+
+    SpatialGrid(qreal cellSize = 64.0)
+        : m_cellSize(cellSize) {
+    }
+
+    // size of the cells that split the bounding box of the points into about cells of them
+    static qreal cellSizeFor(const QVector<qreal> &x, const QVector<qreal> &y, int cells) {
+        if (x.isEmpty())
+            return 1.0;
+        auto xs = std::minmax_element(x.begin(), x.end());
+        auto ys = std::minmax_element(y.begin(), y.end());
+        qreal width = *xs.second - *xs.first;
+        qreal height = *ys.second - *ys.first;
+        qreal size = width * height > 0.0 ? sqrt(width * height / qMax(1, cells)) : qMax(width, height) / qMax(1, cells);
+        return size > 0.0 ? size : 1.0;
+    }
+
+    int size() const {
+        return m_cellOf.size();
+    }
+
+    qreal cellSize() const {
+        return m_cellSize;
+    }
+
+    void clear() {
+        m_cells.clear();
+        m_cellOf.clear();
+    }
+
+    void insert(const T &item, qreal x, qreal y) {
+        quint64 key = cell(x, y);
+        m_cells[key].append({ item, x, y, m_order++ });
+        m_cellOf[item] = key;
+    }
+
+    void remove(const T &item) {
+        if (!m_cellOf.contains(item))
+            return;
+        quint64 key = m_cellOf.take(item);
+        QVector<Entry> &entries = m_cells[key];
+        for (int i = 0; i < entries.size(); i++) {
+            if (entries[i].item == item) {
+                entries.remove(i);
+                break;
+            }
+        }
+        if (entries.isEmpty())
+            m_cells.remove(key);
+    }
+
+    void move(const T &item, qreal x, qreal y) {
+        quint64 key = cell(x, y);
+        if (m_cellOf.value(item, key + 1) == key) {
+            for (Entry &e : m_cells[key]) {
+                if (e.item == item) {
+                    e.x = x;
+                    e.y = y;
+                }
+            }
+            return;
+        }
+        // keep the original order, a moved item is not a new one
+        quint64 order = m_order;
+        for (const Entry &e : m_cells.value(m_cellOf.value(item)))
+            if (e.item == item)
+                order = e.order;
+        remove(item);
+        m_cells[key].append({ item, x, y, order });
+        m_cellOf[item] = key;
+    }
+
+    // calls f on every entry with a point in [x0, x1] x [y0, y1]
+    template<typename F>
+    void visit(qreal x0, qreal y0, qreal x1, qreal y1, F f) const {
+        for (int cx = index(x0); cx <= index(x1); cx++) {
+            for (int cy = index(y0); cy <= index(y1); cy++) {
+                auto it = m_cells.find(key(cx, cy));
+                if (it == m_cells.end())
+                    continue;
+                for (const Entry &e : *it) {
+                    if (e.x >= x0 && e.x <= x1 && e.y >= y0 && e.y <= y1)
+                        f(e);
+                }
+            }
+        }
+    }
+
+    // the k items closest to (x, y) ordered by their distance, items for which skip returns true are left out
+    template<typename F>
+    QVector<T> nearest(qreal x, qreal y, int k, F skip) const {
+        typedef std::pair<qreal, const Entry*> Candidate;
+        std::priority_queue<Candidate> best;
+        if (k <= 0 || m_cells.isEmpty())
+            return QVector<T>();
+
+        auto consider = [&](const QVector<Entry> &entries) {
+            for (const Entry &e : entries) {
+                if (skip(e.item))
+                    continue;
+                qreal d = (e.x - x) * (e.x - x) + (e.y - y) * (e.y - y);
+                if ((int) best.size() < k) {
+                    best.push(Candidate(d, &e));
+                }
+                else if (d < best.top().first) {
+                    best.pop();
+                    best.push(Candidate(d, &e));
+                }
+            }
+        };
+        int visited = 0;
+        auto ringCell = [&](int i, int j) {
+            auto it = m_cells.find(key(i, j));
+            if (it == m_cells.end())
+                return;
+            visited++;
+            consider(*it);
+        };
+
+        // search rings of cells around the point until no unvisited cell can be closer, only
+        // the border of a ring is looked at, once the rings add up to more cells than there are
+        // occupied ones all of those are simply scanned
+        const int cx = index(x);
+        const int cy = index(y);
+        int looked = 0;
+        for (int r = 0; visited < m_cells.size(); r++) {
+            if ((int) best.size() == k && (r - 1) * m_cellSize > sqrt(best.top().first))
+                break;
+            const int ring = r == 0 ? 1 : 8 * r;
+            if (looked + ring > m_cells.size()) {
+                best = std::priority_queue<Candidate>();
+                for (const QVector<Entry> &entries : m_cells)
+                    consider(entries);
+                break;
+            }
+            looked += ring;
+            if (r == 0) {
+                ringCell(cx, cy);
+                continue;
+            }
+            for (int i = cx - r; i <= cx + r; i++) {
+                ringCell(i, cy - r);
+                ringCell(i, cy + r);
+            }
+            for (int j = cy - r + 1; j <= cy + r - 1; j++) {
+                ringCell(cx - r, j);
+                ringCell(cx + r, j);
+            }
+        }
+
+        QVector<T> ret(best.size());
+        for (int i = ret.size() - 1; i >= 0; i--) {
+            ret[i] = best.top().second->item;
+            best.pop();
+        }
+        return ret;
+    }
+private:
+    int index(qreal v) const {
+        return (int) floor(v / m_cellSize);
+    }
+
+    static quint64 key(int cx, int cy) {
+        return ((quint64) (quint32) cx << 32) | (quint32) cy;
+    }
+
+    quint64 cell(qreal x, qreal y) const {
+        return key(index(x), index(y));
+    }
+
+    qreal m_cellSize { 64.0 };
+    quint64 m_order { 0 };
+    QHash<quint64, QVector<Entry>> m_cells { };
+    QHash<T, quint64> m_cellOf { };
+};
+
+#endif // SPATIALGRID_H
@@ -0,0 +1,395 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "transport.h"
+#include "colony.h"
+
+#include <QDataStream>
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutexLocker>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+
+static const quint32 messageMagic = 0x41434f4d; // "ACOM"
+static const quint8 messageVersion = 1;
+static const quint32 maxDatagram = 64 * 1024 * 1024;
+
+////////////////
+//                  MESSAGE
+//
+
+void Message::summarize(const Colony &colony, int k) {
+    const int n = colony.instance()->size();
+    c = colony.c();
+    trip = colony.shortestTrip();
+    tripLength = colony.shortestTripLength();
+
+    this->k = qBound(0, k, qMin(n - 1, 255));
+    maxTrail = 0.0;
+    summaryTowns.resize(n * this->k);
+    summaryTrails.resize(n * this->k);
+    if (this->k == 0)
+        return;
+
+    QVector<int> order;
+    QVector<qreal> strongest(n * this->k, 0.0);
+    const Instance *instance = colony.instance();
+    for (int a = 0; a < n; a++) {
+        order.resize(0);
+        for (int e = instance->edgesBegin(a); e < instance->edgesEnd(a); e++) {
+            if (instance->edgeDistance(e) < HUGE_VAL && instance->edgeTown(e) != a)
+                order.append(e);
+        }
+        int count = qMin(order.size(), (int) this->k);
+        std::partial_sort(order.begin(), order.begin() + count, order.end(), [&colony](int x, int y) {
+            return colony.edgeTrail(x) > colony.edgeTrail(y);
+        });
+        // towns with fewer paths than k point back to themselves, those are skipped when merging
+        for (int j = 0; j < this->k; j++) {
+            summaryTowns[a * this->k + j] = j < count ? instance->edgeTown(order[j]) : a;
+            strongest[a * this->k + j] = j < count ? colony.edgeTrail(order[j]) : 0.0;
+            maxTrail = qMax(maxTrail, strongest[a * this->k + j]);
+        }
+    }
+    for (int i = 0; i < strongest.size(); i++)
+        summaryTrails[i] = maxTrail > 0.0 ? qRound(255.0 * strongest[i] / maxTrail) : 0;
+}
+
+void Message::mergeInto(Colony &colony, qreal weight) const {
+    const Instance *instance = colony.instance();
+    const int n = instance->size();
+
+    // don't trust the peer, it might be running on a different instance
+    if (trip.size() == n) {
+        QVector<bool> visited(n, false);
+        qreal length = 0.0;
+        for (int i = 0; i < n && length < HUGE_VAL; i++) {
+            int t = trip[i];
+            if (t < 0 || t >= n || visited[t]) {
+                length = HUGE_VAL;
+                break;
+            }
+            visited[t] = true;
+            length += instance->distance(t, trip[(i + 1) % n]);
+        }
+        if (length < HUGE_VAL)
+            colony.migrate(trip, length);
+    }
+
+    if (summaryTowns.size() != n * k || !std::isfinite(maxTrail) || maxTrail < 0.0)
+        return;
+    for (int a = 0; a < n; a++) {
+        for (int j = 0; j < k; j++) {
+            int b = summaryTowns[a * k + j];
+            if (b < 0 || b >= n || b == a)
+                continue;
+            qreal trail = maxTrail * summaryTrails[a * k + j] / 255.0;
+            colony.setTrail(a, b, (1.0 - weight) * colony.trail(a, b) + weight * trail);
+            if (instance->symmetric())
+                colony.setTrail(b, a, colony.trail(a, b));
+        }
+    }
+}
+
+QByteArray Message::encode() const {
+    QByteArray raw;
+    QDataStream stream(&raw, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    // town indices take two bytes unless the instance is really big
+    int towns = k > 0 ? summaryTowns.size() / k : trip.size();
+    bool narrow = qMax(towns, trip.size()) <= 0x10000;
+    auto writeIndex = [&stream, narrow](int i) {
+        if (narrow)
+            stream << (quint16) i;
+        else
+            stream << (quint32) i;
+    };
+
+    stream << messageMagic << messageVersion << node << c << tripLength << (quint8) narrow;
+    stream << (quint32) trip.size();
+    for (int t : trip)
+        writeIndex(t);
+    stream << k << maxTrail << (quint32) summaryTowns.size();
+    for (int t : summaryTowns)
+        writeIndex(t);
+    stream.writeRawData(reinterpret_cast<const char*>(summaryTrails.constData()), summaryTrails.size());
+    return qCompress(raw);
+}
+
+bool Message::decode(const QByteArray &datagram, Message &message) {
+    // qUncompress() allocates whatever size the first four bytes claim
+    if (datagram.size() < 4 || qFromBigEndian<quint32>(datagram.constData()) > maxDatagram)
+        return false;
+    QByteArray raw = qUncompress(datagram);
+    if (raw.isEmpty())
+        return false;
+    QDataStream stream(raw);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic;
+    quint8 version, narrow;
+    stream >> magic >> version;
+    if (magic != messageMagic || version != messageVersion)
+        return false;
+    stream >> message.node >> message.c >> message.tripLength >> narrow;
+    auto readIndices = [&stream, &raw, narrow](QVector<int> &indices) {
+        quint32 count;
+        stream >> count;
+        if (stream.status() != QDataStream::Ok || count > (quint32) raw.size())
+            return false;
+        indices.resize(count);
+        for (int &i : indices) {
+            if (narrow) {
+                quint16 index;
+                stream >> index;
+                i = index;
+            }
+            else {
+                quint32 index;
+                stream >> index;
+                i = index;
+            }
+        }
+        return true;
+    };
+    if (!readIndices(message.trip))
+        return false;
+    stream >> message.k >> message.maxTrail;
+    if (!readIndices(message.summaryTowns))
+        return false;
+    int count = message.summaryTowns.size();
+    message.summaryTrails.resize(count);
+    if (stream.readRawData(reinterpret_cast<char*>(message.summaryTrails.data()), count) != count)
+        return false;
+    return stream.status() == QDataStream::Ok;
+}
+
+
+////////////////
+//                  TRANSPORT
+//
+
+Transport::Transport(QObject *parent)
+    : QObject(parent) {
+}
+
+Transport *Transport::create(const QString &address, QObject *parent) {
+    QString scheme = address.section(':', 0, 0);
+    QString rest = address.section(':', 1);
+    if (scheme == "inprocess")
+        return new InProcessTransport(rest, parent);
+    if (scheme == "local")
+        return new LocalSocketTransport(rest, parent);
+    if (scheme == "tcp") {
+        QString host = "localhost";
+        if (rest.contains(':')) {
+            host = rest.section(':', 0, 0);
+            rest = rest.section(':', 1);
+        }
+        return new TcpTransport(host, rest.toUShort(), parent);
+    }
+    qWarning() << "Unknown transport" << address;
+    return nullptr;
+}
+
+
+////////////////
+//                  IN-PROCESS TRANSPORT
+//
+
+QMutex InProcessTransport::s_mutex;
+QHash<QString, QList<InProcessTransport*>> InProcessTransport::s_hubs;
+
+InProcessTransport::InProcessTransport(const QString &hub, QObject *parent)
+    : Transport(parent), m_hub(hub) {
+    QMutexLocker locker(&s_mutex);
+    s_hubs[m_hub].append(this);
+}
+
+InProcessTransport::~InProcessTransport() {
+    QMutexLocker locker(&s_mutex);
+    s_hubs[m_hub].removeOne(this);
+    if (s_hubs[m_hub].isEmpty())
+        s_hubs.remove(m_hub);
+}
+
+void InProcessTransport::send(const QByteArray &datagram) {
+    QMutexLocker locker(&s_mutex);
+    for (InProcessTransport *peer : s_hubs[m_hub]) {
+        if (peer != this)
+            QMetaObject::invokeMethod(peer, "deliver", Qt::QueuedConnection, Q_ARG(QByteArray, datagram));
+    }
+}
+
+void InProcessTransport::connectToPeer(const QString &address) {
+    // everyone on the hub is a peer already
+    Q_UNUSED(address)
+}
+
+void InProcessTransport::deliver(const QByteArray &datagram) {
+    emit received(datagram);
+}
+
+
+////////////////
+//                  SOCKET TRANSPORT
+//
+
+SocketTransport::SocketTransport(QObject *parent)
+    : Transport(parent) {
+}
+
+void SocketTransport::send(const QByteArray &datagram) {
+    QByteArray frame(4, 0);
+    qToBigEndian<quint32>(datagram.size(), reinterpret_cast<uchar*>(frame.data()));
+    frame.append(datagram);
+    // only the connections we opened are used for sending, the accepted
+    // ones belong to peers that send to us
+    for (QIODevice *device : m_addresses.keys()) {
+        if (device->bytesToWrite() > maxBacklog)
+            continue;
+        device->write(frame);
+    }
+}
+
+void SocketTransport::connectToPeer(const QString &address) {
+    openConnection(address);
+}
+
+void SocketTransport::addConnection(QIODevice *device, const QString &address) {
+    m_connections.append(device);
+    if (!address.isEmpty())
+        m_addresses[device] = address;
+    connect(device, &QIODevice::readyRead, this, &SocketTransport::readConnection);
+}
+
+void SocketTransport::readConnection() {
+    QIODevice *device = qobject_cast<QIODevice*>(sender());
+    if (!device || !m_connections.contains(device))
+        return;
+    QByteArray &buffer = m_buffers[device];
+    buffer.append(device->readAll());
+    while (buffer.size() >= 4) {
+        quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
+        if (length > maxDatagram) {
+            qWarning() << "Dropping a peer sending oversized datagrams";
+            buffer.clear();
+            device->close();
+            return;
+        }
+        if ((quint32) buffer.size() < 4 + length)
+            break;
+        emit received(buffer.mid(4, length));
+        buffer.remove(0, 4 + length);
+    }
+}
+
+void SocketTransport::dropConnection() {
+    QIODevice *device = qobject_cast<QIODevice*>(sender());
+    if (!device || !m_connections.removeOne(device))
+        return;
+    QString address = m_addresses.take(device);
+    m_buffers.remove(device);
+    device->deleteLater();
+    if (!address.isEmpty()) {
+        QTimer::singleShot(reconnectInterval, this, [this, address]() {
+            connectToPeer(address);
+        });
+    }
+}
+
+
+////////////////
+//                  LOCAL SOCKET TRANSPORT
+//
+
+LocalSocketTransport::LocalSocketTransport(const QString &name, QObject *parent)
+    : SocketTransport(parent), m_server(new QLocalServer(this)) {
+    connect(m_server, &QLocalServer::newConnection, this, &LocalSocketTransport::acceptConnection);
+    QLocalServer::removeServer(name);
+    if (!m_server->listen(name))
+        qWarning() << "Can't listen on" << name << m_server->errorString();
+}
+
+void LocalSocketTransport::openConnection(const QString &address) {
+    QLocalSocket *socket = new QLocalSocket(this);
+    connect(socket, &QLocalSocket::disconnected, this, &LocalSocketTransport::dropConnection);
+    connect(socket, static_cast<void (QLocalSocket::*)(QLocalSocket::LocalSocketError)>(&QLocalSocket::error),
+            this, &LocalSocketTransport::dropConnection);
+    addConnection(socket, address);
+    socket->connectToServer(address.section(':', 1));
+}
+
+void LocalSocketTransport::acceptConnection() {
+    while (m_server->hasPendingConnections()) {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        connect(socket, &QLocalSocket::disconnected, this, &LocalSocketTransport::dropConnection);
+        addConnection(socket);
+    }
+}
+
+
+////////////////
+//                  TCP TRANSPORT
+//
+
+TcpTransport::TcpTransport(const QString &host, quint16 port, QObject *parent)
+    : SocketTransport(parent), m_server(new QTcpServer(this)) {
+    connect(m_server, &QTcpServer::newConnection, this, &TcpTransport::acceptConnection);
+    QHostAddress address = host == "localhost" ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(host);
+    if (!m_server->listen(address, port))
+        qWarning() << "Can't listen on" << host << port << m_server->errorString();
+}
+
+void TcpTransport::openConnection(const QString &address) {
+    QString rest = address.section(':', 1);
+    QString host = "localhost";
+    if (rest.contains(':')) {
+        host = rest.section(':', 0, 0);
+        rest = rest.section(':', 1);
+    }
+    QTcpSocket *socket = new QTcpSocket(this);
+    connect(socket, &QTcpSocket::disconnected, this, &TcpTransport::dropConnection);
+    connect(socket, static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
+            this, &TcpTransport::dropConnection);
+    addConnection(socket, address);
+    socket->connectToHost(host, rest.toUShort());
+}
+
+void TcpTransport::acceptConnection() {
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, this, &TcpTransport::dropConnection);
+        addConnection(socket);
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+
+#include <cmath>
+
+class Colony;
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+/**
+ * What a node tells its peers: its shortest trip and, for every town,
+ * the k strongest trails leaving it quantized to a single byte.
+ */
+struct Message {
+    quint32 node { 0 };
+    quint32 c { 0 };
+    qreal tripLength { HUGE_VAL };
+    QVector<int> trip { };
+
+    quint8 k { 0 };
+    qreal maxTrail { 0.0 };
+    QVector<int> summaryTowns { };
+    QVector<quint8> summaryTrails { };
+
+    void summarize(const Colony &colony, int k);
+    void mergeInto(Colony &colony, qreal weight) const;
+
+    QByteArray encode() const;
+    static bool decode(const QByteArray &datagram, Message &message);
+};
+
+/**
+ * Delivers datagrams to all connected peers. Sending never blocks, what
+ * can't be delivered is dropped.
+ *
+ * Addresses:
+ *   inprocess:<hub>        all transports on the same hub see each other
+ *   local:<name>           local (Unix) socket
+ *   tcp:[<host>:]<port>    TCP socket, localhost by default
+ */
+class Transport : public QObject {
+    Q_OBJECT
+public:
+    Transport(QObject *parent = nullptr);
+    static Transport *create(const QString &address, QObject *parent = nullptr);
+public slots:
+    virtual void send(const QByteArray &datagram) = 0;
+    virtual void connectToPeer(const QString &address) = 0;
+signals:
+    void received(const QByteArray &datagram);
+};
+
+class InProcessTransport : public Transport {
+    Q_OBJECT
+public:
+    InProcessTransport(const QString &hub, QObject *parent = nullptr);
+    ~InProcessTransport();
+public slots:
+    void send(const QByteArray &datagram) override;
+    void connectToPeer(const QString &address) override;
+private slots:
+    void deliver(const QByteArray &datagram);
+private:
+    static QMutex s_mutex;
+    static QHash<QString, QList<InProcessTransport*>> s_hubs;
+    QString m_hub { };
+};
+
+/**
+ * Common part of the socket transports. Datagrams are framed by their
+ * length, peers with more than maxBacklog bytes waiting are skipped and
+ * lost peers are reconnected in the background.
+ */
+class SocketTransport : public Transport {
+    Q_OBJECT
+public:
+    static const qint64 maxBacklog = 4 * 1024 * 1024;
+    static const int reconnectInterval = 1000;
+
+    SocketTransport(QObject *parent = nullptr);
+public slots:
+    void send(const QByteArray &datagram) override;
+    void connectToPeer(const QString &address) override;
+protected:
+    virtual void openConnection(const QString &address) = 0;
+    void addConnection(QIODevice *device, const QString &address = QString());
+protected slots:
+    void readConnection();
+    void dropConnection();
+private:
+    QList<QIODevice*> m_connections { };
+    QHash<QIODevice*, QByteArray> m_buffers { };
+    QHash<QIODevice*, QString> m_addresses { };
+};
+
+class LocalSocketTransport : public SocketTransport {
+    Q_OBJECT
+public:
+    LocalSocketTransport(const QString &name, QObject *parent = nullptr);
+protected:
+    void openConnection(const QString &address) override;
+private slots:
+    void acceptConnection();
+private:
+    QLocalServer *m_server { nullptr };
+};
+
+class TcpTransport : public SocketTransport {
+    Q_OBJECT
+public:
+    TcpTransport(const QString &host, quint16 port, QObject *parent = nullptr);
+protected:
+    void openConnection(const QString &address) override;
+private slots:
+    void acceptConnection();
+private:
+    QTcpServer *m_server { nullptr };
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,261 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "tsplib.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <cmath>
+
+static bool fail(Tsplib &tsplib, const QString &error) {
+    tsplib.error = error;
+    return false;
+}
+
+template<Tsplib::Metric M>
+static qreal metricDistance(qreal x1, qreal y1, qreal x2, qreal y2);
+
+template<>
+qreal metricDistance<Tsplib::Euclidean>(qreal x1, qreal y1, qreal x2, qreal y2) {
+    qreal dx = x1 - x2;
+    qreal dy = y1 - y2;
+    return (int) (sqrt(dx * dx + dy * dy) + 0.5);
+}
+
+template<>
+qreal metricDistance<Tsplib::Ceiling>(qreal x1, qreal y1, qreal x2, qreal y2) {
+    qreal dx = x1 - x2;
+    qreal dy = y1 - y2;
+    return ceil(sqrt(dx * dx + dy * dy));
+}
+
+template<>
+qreal metricDistance<Tsplib::Att>(qreal x1, qreal y1, qreal x2, qreal y2) {
+    qreal dx = x1 - x2;
+    qreal dy = y1 - y2;
+    qreal r = sqrt((dx * dx + dy * dy) / 10.0);
+    int t = (int) (r + 0.5);
+    return t < r ? t + 1 : t;
+}
+
+template<>
+qreal metricDistance<Tsplib::Geographic>(qreal x1, qreal y1, qreal x2, qreal y2) {
+    // x is the latitude, y the longitude, both in DDD.MM format
+    auto radians = [](qreal v) {
+        int deg = (int) v;
+        return 3.141592 * (deg + 5.0 * (v - deg) / 3.0) / 180.0;
+    };
+    qreal q1 = cos(radians(y1) - radians(y2));
+    qreal q2 = cos(radians(x1) - radians(x2));
+    qreal q3 = cos(radians(x1) + radians(x2));
+    return (int) (6378.388 * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+}
+
+// the metric is known for the whole loop, all of them are symmetric
+template<Tsplib::Metric M>
+static void fillMatrix(Tsplib &tsplib) {
+    const int n = tsplib.instance.size();
+    if (n == 0)
+        return;
+    qreal *matrix = tsplib.instance.row(0);
+    const qreal *x = tsplib.x.constData();
+    const qreal *y = tsplib.y.constData();
+    for (int a = 0; a < n; a++) {
+        for (int b = a + 1; b < n; b++)
+            matrix[a * n + b] = matrix[b * n + a] = metricDistance<M>(x[a], y[a], x[b], y[b]);
+    }
+}
+
+bool Tsplib::parse(const QByteArray &data, Tsplib &tsplib, bool matrix, int maxTowns) {
+    static const QRegularExpression keyword("^\\s*([A-Z_]+)\\s*:\\s*(.*)$");
+    static const QRegularExpression whitespace("\\s+");
+
+    QStringList lines = QString::fromLatin1(data).split('\n');
+    int dimension = -1;
+    QString type, weightType, weightFormat = "FULL_MATRIX";
+    int line = 0;
+    bool header = false;
+
+    // the specification part, anything that doesn't look like it means this is not a TSPLIB file
+    for (; line < lines.size(); line++) {
+        QString l = lines[line].trimmed();
+        if (l.isEmpty())
+            continue;
+        if (l.endsWith("_SECTION") || l == "EOF")
+            break;
+        QRegularExpressionMatch match = keyword.match(l);
+        if (!match.hasMatch())
+            return false;
+        header = true;
+        QString key = match.captured(1);
+        QString value = match.captured(2).trimmed();
+        if (key == "NAME")
+            tsplib.name = value;
+        else if (key == "TYPE")
+            type = value;
+        else if (key == "DIMENSION")
+            dimension = value.toInt();
+        else if (key == "EDGE_WEIGHT_TYPE")
+            weightType = value;
+        else if (key == "EDGE_WEIGHT_FORMAT")
+            weightFormat = value;
+    }
+    // not a single keyword, an empty file or one in the format of the application
+    if (!header)
+        return false;
+    if (dimension <= 0)
+        return fail(tsplib, "Missing DIMENSION");
+    int limit = matrix ? maxMatrixDimension : maxDimension;
+    if (dimension > (maxTowns > 0 ? qMin(maxTowns, limit) : limit))
+        return fail(tsplib, QString("DIMENSION %1 is too big").arg(dimension));
+    if (type != "TSP" && type != "ATSP")
+        return fail(tsplib, QString("Unsupported TYPE %1").arg(type));
+
+    tsplib.symmetric = type == "TSP";
+    if (weightType == "EUC_2D")
+        tsplib.metric = Euclidean;
+    else if (weightType == "CEIL_2D")
+        tsplib.metric = Ceiling;
+    else if (weightType == "ATT")
+        tsplib.metric = Att;
+    else if (weightType == "GEO")
+        tsplib.metric = Geographic;
+    else if (weightType == "EXPLICIT")
+        tsplib.metric = Explicit;
+    else
+        return fail(tsplib, QString("Unsupported EDGE_WEIGHT_TYPE %1").arg(weightType));
+
+    // the data part is just a stream of numbers, line breaks don't matter
+    QStringList tokens;
+    for (; line < lines.size(); line++)
+        tokens += lines[line].split(whitespace, QString::SkipEmptyParts);
+
+    if (!matrix && tsplib.metric == Explicit)
+        return fail(tsplib, "EXPLICIT weights have no coordinates to work with");
+    // don't allocate anything for a file that can't possibly hold the whole instance
+    qint64 needed = tsplib.metric == Explicit ? qint64(dimension) * (dimension - 1) / 2 : qint64(3) * dimension;
+    if (tokens.size() < needed)
+        return fail(tsplib, QString("Too little data for DIMENSION %1").arg(dimension));
+    tsplib.instance = Instance(matrix ? dimension : 0);
+    tsplib.instance.setSymmetric(tsplib.symmetric);
+    QVector<qreal> weights;
+    int pos = 0;
+    while (pos < tokens.size()) {
+        QString section = tokens[pos++];
+        if (section == "EOF")
+            break;
+        if (section == "NODE_COORD_SECTION" || section == "DISPLAY_DATA_SECTION") {
+            if (pos + 3 * dimension > tokens.size())
+                return fail(tsplib, QString("Truncated %1").arg(section));
+            tsplib.x.resize(dimension);
+            tsplib.y.resize(dimension);
+            for (int i = 0; i < dimension; i++) {
+                int town = tokens[pos].toInt() - 1;
+                if (town < 0 || town >= dimension)
+                    return fail(tsplib, QString("Invalid town %1").arg(tokens[pos]));
+                tsplib.x[town] = tokens[pos + 1].toDouble();
+                tsplib.y[town] = tokens[pos + 2].toDouble();
+                pos += 3;
+            }
+        }
+        else if (section == "EDGE_WEIGHT_SECTION") {
+            while (pos < tokens.size() && !tokens[pos].endsWith("_SECTION") && tokens[pos] != "EOF")
+                weights.append(tokens[pos++].toDouble());
+        }
+        else {
+            // FIXED_EDGES_SECTION, TOUR_SECTION and alike are of no use here
+            while (pos < tokens.size() && !tokens[pos].endsWith("_SECTION") && tokens[pos] != "EOF")
+                pos++;
+        }
+    }
+
+    Instance &instance = tsplib.instance;
+    if (tsplib.metric != Explicit) {
+        if (tsplib.x.size() != dimension)
+            return fail(tsplib, "Missing NODE_COORD_SECTION");
+        if (!matrix)
+            return true;
+        switch (tsplib.metric) {
+        case Euclidean:
+            fillMatrix<Euclidean>(tsplib);
+            break;
+        case Ceiling:
+            fillMatrix<Ceiling>(tsplib);
+            break;
+        case Att:
+            fillMatrix<Att>(tsplib);
+            break;
+        case Geographic:
+            fillMatrix<Geographic>(tsplib);
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    // explicit weights, walk the matrix in the order of the format and skip the diagonal
+    bool full = weightFormat == "FULL_MATRIX";
+    bool upper = weightFormat.startsWith("UPPER");
+    bool lower = weightFormat.startsWith("LOWER");
+    bool diagonal = weightFormat.endsWith("DIAG_ROW");
+    if (!full && !((upper || lower) && weightFormat.contains("ROW")))
+        return fail(tsplib, QString("Unsupported EDGE_WEIGHT_FORMAT %1").arg(weightFormat));
+    if (!full && !tsplib.symmetric)
+        return fail(tsplib, "An ATSP needs a FULL_MATRIX");
+
+    int w = 0;
+    for (int a = 0; a < dimension; a++) {
+        int from = full ? 0 : upper ? (diagonal ? a : a + 1) : 0;
+        int to = full ? dimension : upper ? dimension : (diagonal ? a + 1 : a);
+        for (int b = from; b < to; b++) {
+            if (w >= weights.size())
+                return fail(tsplib, "Truncated EDGE_WEIGHT_SECTION");
+            qreal weight = weights[w++];
+            if (a == b)
+                continue;
+            instance.setDistance(a, b, weight);
+            if (!full)
+                instance.setDistance(b, a, weight);
+        }
+    }
+    return true;
+}
+
+qreal Tsplib::distance(Metric metric, qreal x1, qreal y1, qreal x2, qreal y2) {
+    switch (metric) {
+    case Euclidean:
+        return metricDistance<Euclidean>(x1, y1, x2, y2);
+    case Ceiling:
+        return metricDistance<Ceiling>(x1, y1, x2, y2);
+    case Att:
+        return metricDistance<Att>(x1, y1, x2, y2);
+    case Geographic:
+        return metricDistance<Geographic>(x1, y1, x2, y2);
+    default:
+        return HUGE_VAL;
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef TSPLIB_H
+#define TSPLIB_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "colony.h"
+
+/**
+ * Reader of TSPLIB files (symmetric TSP and ATSP). Towns given by their
+ * coordinates get the distances of their EDGE_WEIGHT_TYPE, explicit
+ * weights are read in any of the usual matrix formats.
+ */
+class Tsplib {
+public:
+    enum Metric {
+        Explicit = 0,
+        Euclidean,
+        Ceiling,
+        Att,
+        Geographic,
+    };
+
+    // a matrix of dimension^2 distances is allocated up front, without it only the coordinates
+    static const int maxMatrixDimension = 20000;
+    static const int maxDimension = 10000000;
+
+    // without the matrix only the coordinates are read, for instances too big for one,
+    // a positive maxTowns lowers the limit on DIMENSION
+    static bool parse(const QByteArray &data, Tsplib &tsplib, bool matrix = true, int maxTowns = 0);
+    static qreal distance(Metric metric, qreal x1, qreal y1, qreal x2, qreal y2);
+
+    QString name { };
+    QString error { };
+    bool symmetric { true };
+    Metric metric { Explicit };
+    // coordinates of the towns, may come from DISPLAY_DATA_SECTION for explicit weights
+    QVector<qreal> x { };
+    QVector<qreal> y { };
+    Instance instance { };
+};
+
+#endif // TSPLIB_H
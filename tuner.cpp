@@ -0,0 +1,336 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "tuner.h"
+#include "aco.h"
+#include "solver.h"
+
+#include <QJsonDocument>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+// a parameter the tuner varies and the range it's sampled from
+struct Dimension {
+    qreal Parameters::*value;
+    qreal min;
+    qreal max;
+    bool logarithmic;
+};
+
+static const Dimension dimensions[] = {
+    { &Parameters::alpha, 0.1, 5.0, false },
+    { &Parameters::beta, 0.5, 10.0, false },
+    { &Parameters::ro, 0.01, 0.99, false },
+    { &Parameters::q, 0.1, 1000.0, true },
+    { &Parameters::e, 0.5, 20.0, true },
+};
+static const qreal minAnts = 2;
+static const qreal maxAnts = 100;
+
+static qreal normalize(qreal value, qreal min, qreal max, bool logarithmic) {
+    if (logarithmic)
+        return (log(value) - log(min)) / (log(max) - log(min));
+    return (value - min) / (max - min);
+}
+
+static qreal denormalize(qreal value, qreal min, qreal max, bool logarithmic) {
+    value = qBound(0.0, value, 1.0);
+    if (logarithmic)
+        return exp(log(min) + value * (log(max) - log(min)));
+    return min + value * (max - min);
+}
+
+// quantile of the standard normal distribution (Abramowitz and Stegun 26.2.23)
+static qreal normalQuantile(qreal p) {
+    bool lower = p < 0.5;
+    qreal t = sqrt(-2.0 * log(lower ? p : 1.0 - p));
+    qreal z = t - (2.515517 + 0.802853 * t + 0.010328 * t * t) / (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+    return lower ? -z : z;
+}
+
+// Wilson and Hilferty approximation
+static qreal chiSquaredQuantile(qreal p, int df) {
+    qreal z = normalQuantile(p);
+    qreal a = 2.0 / (9.0 * df);
+    return df * pow(1.0 - a + z * sqrt(a), 3);
+}
+
+// Cornish-Fisher expansion around the normal distribution
+static qreal studentQuantile(qreal p, int df) {
+    qreal z = normalQuantile(p);
+    return z + (pow(z, 3) + z) / (4.0 * df) + (5.0 * pow(z, 5) + 16.0 * pow(z, 3) + 3.0 * z) / (96.0 * df * df);
+}
+
+Tuner::Tuner(const QVector<Instance> &instances, const Parameters &base, quint32 seed)
+    : m_instances(instances), m_base(base), m_mersenneTwister(seed) {
+    for (Instance &instance : m_instances) {
+        if (instance.neighbourCount() == 0)
+            instance.buildNeighbours(Instance::defaultNeighbourCount);
+    }
+}
+
+int Tuner::iterations() const {
+    return m_iterations;
+}
+
+int Tuner::candidateCount() const {
+    return m_candidateCount;
+}
+
+int Tuner::eliteCount() const {
+    return m_eliteCount;
+}
+
+int Tuner::firstTest() const {
+    return m_firstTest;
+}
+
+int Tuner::maxBlocks() const {
+    return m_maxBlocks;
+}
+
+int Tuner::cycles() const {
+    return m_cycles;
+}
+
+qreal Tuner::significance() const {
+    return m_significance;
+}
+
+void Tuner::setIterations(int iterations) {
+    m_iterations = qMax(1, iterations);
+}
+
+void Tuner::setCandidateCount(int count) {
+    m_candidateCount = qMax(2, count);
+}
+
+void Tuner::setEliteCount(int count) {
+    m_eliteCount = qMax(1, count);
+}
+
+void Tuner::setFirstTest(int blocks) {
+    m_firstTest = qMax(2, blocks);
+}
+
+void Tuner::setMaxBlocks(int blocks) {
+    m_maxBlocks = qMax(1, blocks);
+}
+
+void Tuner::setCycles(int cycles) {
+    m_cycles = qMax(1, cycles);
+}
+
+void Tuner::setSignificance(qreal alpha) {
+    m_significance = qBound(0.001, alpha, 0.5);
+}
+
+Parameters Tuner::tune(const Log &log) {
+    QVector<Parameters> elites { m_base };
+    if (m_instances.isEmpty())
+        return m_base;
+
+    for (int iteration = 0; iteration < m_iterations; iteration++) {
+        QVector<Candidate> candidates;
+        while (candidates.size() < qMax(m_candidateCount, elites.size() + 1)) {
+            Candidate candidate;
+            candidate.parameters = candidates.size() < elites.size() ? elites[candidates.size()] : sample(elites, iteration);
+            candidates.append(candidate);
+        }
+
+        race(candidates, log);
+
+        // the survivors ordered by their mean rank become the elites of the next iteration
+        int blocks = 0;
+        for (const Candidate &candidate : candidates) {
+            if (candidate.alive)
+                blocks = candidate.lengths.size();
+        }
+        QVector<qreal> ranks = meanRanks(candidates, blocks);
+        QVector<int> order;
+        for (int i = 0; i < candidates.size(); i++) {
+            if (candidates[i].alive)
+                order.append(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [&ranks](int a, int b) {
+            return ranks[a] < ranks[b];
+        });
+        elites.clear();
+        for (int i = 0; i < order.size() && i < m_eliteCount; i++)
+            elites.append(candidates[order[i]].parameters);
+
+        if (log) {
+            log(QString("iteration %1: best %2").arg(iteration + 1)
+                .arg(QString::fromUtf8(QJsonDocument(elites.first().toJson()).toJson(QJsonDocument::Compact))));
+        }
+    }
+    return elites.first();
+}
+
+Parameters Tuner::sample(const QVector<Parameters> &elites, int iteration) {
+    std::uniform_real_distribution<qreal> uniform(0.0, 1.0);
+    Parameters p = m_base;
+
+    // the first iteration explores the whole range, later ones stay closer and closer to the elites
+    if (iteration == 0) {
+        for (const Dimension &d : dimensions)
+            p.*d.value = denormalize(uniform(m_mersenneTwister), d.min, d.max, d.logarithmic);
+        p.antCount = qRound(denormalize(uniform(m_mersenneTwister), minAnts, maxAnts, true));
+        return p;
+    }
+
+    // better elites are picked more often
+    QVector<qreal> weights;
+    for (int i = 0; i < elites.size(); i++)
+        weights.append(elites.size() - i);
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+    const Parameters &elite = elites[pick(m_mersenneTwister)];
+
+    qreal deviation = 0.3 * pow(0.5, iteration - 1);
+    std::normal_distribution<qreal> normal(0.0, deviation);
+    for (const Dimension &d : dimensions) {
+        qreal value = normalize(elite.*d.value, d.min, d.max, d.logarithmic) + normal(m_mersenneTwister);
+        p.*d.value = denormalize(value, d.min, d.max, d.logarithmic);
+    }
+    qreal ants = normalize(qBound(minAnts, qreal(elite.antCount), maxAnts), minAnts, maxAnts, true) + normal(m_mersenneTwister);
+    p.antCount = qRound(denormalize(ants, minAnts, maxAnts, true));
+    return p;
+}
+
+void Tuner::race(QVector<Candidate> &candidates, const Log &log) {
+    for (int block = 0; block < m_maxBlocks; block++) {
+        QVector<int> alive;
+        for (int i = 0; i < candidates.size(); i++) {
+            if (candidates[i].alive)
+                alive.append(i);
+        }
+        if (alive.size() <= 1)
+            break;
+
+        const Instance &instance = m_instances[block % m_instances.size()];
+        quint32 seed = m_mersenneTwister();
+        for (int i : alive)
+            candidates[i].lengths.resize(block + 1);
+        QtConcurrent::blockingMap(alive, [&](int &i) {
+            Solver solver(candidates[i].parameters, seed);
+            solver.setMaxCycles(m_cycles);
+            candidates[i].lengths[block] = solver.solve(instance, -1).length;
+        });
+
+        if (block + 1 >= m_firstTest)
+            eliminate(candidates, block + 1);
+
+        if (log) {
+            int left = 0;
+            for (const Candidate &candidate : candidates)
+                left += candidate.alive;
+            log(QString("block %1: %2 of %3 configurations left").arg(block + 1).arg(left).arg(candidates.size()));
+        }
+    }
+}
+
+void Tuner::eliminate(QVector<Candidate> &candidates, int blocks) {
+    QVector<int> alive;
+    for (int i = 0; i < candidates.size(); i++) {
+        if (candidates[i].alive)
+            alive.append(i);
+    }
+    const int k = alive.size();
+    const int b = blocks;
+    if (k < 2)
+        return;
+
+    // rank sums and the sum of the squared ranks
+    QVector<qreal> sums(k, 0.0);
+    qreal squares = 0.0;
+    QVector<int> order(k);
+    for (int block = 0; block < b; block++) {
+        for (int i = 0; i < k; i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int x, int y) {
+            return candidates[alive[x]].lengths[block] < candidates[alive[y]].lengths[block];
+        });
+        for (int i = 0; i < k; ) {
+            int j = i;
+            while (j + 1 < k && candidates[alive[order[j + 1]]].lengths[block] == candidates[alive[order[i]]].lengths[block])
+                j++;
+            // ties share the mean of their ranks
+            qreal rank = (i + j) / 2.0 + 1.0;
+            for (int l = i; l <= j; l++) {
+                sums[order[l]] += rank;
+                squares += rank * rank;
+            }
+            i = j + 1;
+        }
+    }
+
+    // Friedman: T = (k - 1)(sum R_j^2 - b C1) / (A1 - C1), C1 = b k (k + 1)^2 / 4
+    qreal c = b * k * (k + 1) * (k + 1) / 4.0;
+    qreal sumOfSquares = 0.0;
+    for (qreal sum : sums)
+        sumOfSquares += sum * sum;
+    if (squares - c <= 0.0)
+        return;
+    qreal t = (k - 1) * (sumOfSquares - b * c) / (squares - c);
+    if (t <= chiSquaredQuantile(1.0 - m_significance, k - 1))
+        return;
+
+    // Conover: everything further from the best than the critical difference goes
+    int df = (b - 1) * (k - 1);
+    qreal variance = 2.0 * (b * squares - sumOfSquares) / df;
+    qreal difference = studentQuantile(1.0 - m_significance / 2.0, df) * sqrt(qMax(0.0, variance));
+    qreal best = *std::min_element(sums.begin(), sums.end());
+    for (int i = 0; i < k; i++) {
+        if (sums[i] - best > difference)
+            candidates[alive[i]].alive = false;
+    }
+}
+
+QVector<qreal> Tuner::meanRanks(const QVector<Candidate> &candidates, int blocks) const {
+    QVector<qreal> ranks(candidates.size(), HUGE_VAL);
+    QVector<int> alive;
+    for (int i = 0; i < candidates.size(); i++) {
+        if (candidates[i].alive)
+            alive.append(i);
+    }
+    for (int i : alive) {
+        qreal sum = 0.0;
+        for (int block = 0; block < blocks; block++) {
+            qreal length = candidates[i].lengths[block];
+            int better = 0;
+            int same = 0;
+            for (int j : alive) {
+                better += candidates[j].lengths[block] < length;
+                same += candidates[j].lengths[block] == length;
+            }
+            sum += better + (same + 1) / 2.0;
+        }
+        ranks[i] = blocks > 0 ? sum / blocks : 0.0;
+    }
+    return ranks;
+}
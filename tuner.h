@@ -0,0 +1,96 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Martin Bříza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <random>
+
+#include "colony.h"
+
+/**
+ * Iterated racing over the parameters of the algorithm. Every iteration
+ * samples new configurations around the best ones found so far and races
+ * them: all configurations still in the race solve the next training
+ * instance in parallel, and once firstTest instances are done the ones
+ * that are significantly worse than the best (Friedman test followed by
+ * the Conover post-hoc test) are dropped.
+ *
+ * All configurations solve the same instance with the same seed, so the
+ * differences between them come from the parameters alone.
+ */
+class Tuner {
+public:
+    struct Candidate {
+        Parameters parameters { };
+        QVector<qreal> lengths { };
+        bool alive { true };
+    };
+
+    typedef std::function<void(const QString &message)> Log;
+
+    Tuner(const QVector<Instance> &instances, const Parameters &base, quint32 seed = 0);
+
+    int iterations() const;
+    int candidateCount() const;
+    int eliteCount() const;
+    int firstTest() const;
+    int maxBlocks() const;
+    int cycles() const;
+    qreal significance() const;
+    void setIterations(int iterations);
+    void setCandidateCount(int count);
+    void setEliteCount(int count);
+    void setFirstTest(int blocks);
+    void setMaxBlocks(int blocks);
+    void setCycles(int cycles);
+    void setSignificance(qreal alpha);
+
+    Parameters tune(const Log &log = Log());
+private:
+    Parameters sample(const QVector<Parameters> &elites, int iteration);
+    void race(QVector<Candidate> &candidates, const Log &log);
+    void eliminate(QVector<Candidate> &candidates, int blocks);
+    QVector<qreal> meanRanks(const QVector<Candidate> &candidates, int blocks) const;
+
+    QVector<Instance> m_instances { };
+    Parameters m_base { };
+    std::mt19937 m_mersenneTwister { };
+
+    int m_iterations { 4 };
+    int m_candidateCount { 16 };
+    int m_eliteCount { 3 };
+    int m_firstTest { 5 };
+    int m_maxBlocks { 20 };
+    int m_cycles { 100 };
+    qreal m_significance { 0.05 };
+};
+
+#endif // TUNER_H